@@ -0,0 +1,180 @@
+// Benchmark runner behind the `lox_bench` target. Runs every script several times with the
+// interpreter, and prints median and p95 wall time plus peak RSS per script as JSON. A
+// previous run's JSON can be passed as a baseline, which adds the relative change.
+//
+//   bench_runner --interpreter=PATH [--engine=tree|vm|closure] [--runs=N] [--baseline=FILE]
+//                [--output=FILE] script.lox...
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct Sample {
+    double ms;
+    long peak_rss_kb;
+};
+
+struct Result {
+    std::string name;
+    double median_ms;
+    double p95_ms;
+    long peak_rss_kb;
+};
+
+static std::string benchName(const std::string &path) {
+    const size_t slash = path.find_last_of('/');
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    if (name.size() > 4 && name.ends_with(".lox")) { name.resize(name.size() - 4); }
+    return name;
+}
+
+// Runs the interpreter once with stdout discarded; wait4 reports the child's own peak RSS.
+static Sample runOnce(const std::string &interpreter, const std::string &engine, const std::string &script) {
+    const auto start = std::chrono::steady_clock::now();
+    const pid_t pid = fork();
+    if (pid < 0) { throw std::runtime_error("fork failed"); }
+    if (pid == 0) {
+        if (const int null = open("/dev/null", O_WRONLY); null >= 0) { dup2(null, STDOUT_FILENO); }
+        const std::string engine_flag = "--engine=" + engine;
+        execl(interpreter.c_str(), interpreter.c_str(), engine_flag.c_str(), script.c_str(), nullptr);
+        _exit(127);
+    }
+
+    int status = 0;
+    rusage usage {};
+    if (wait4(pid, &status, 0, &usage) < 0) { throw std::runtime_error("wait4 failed"); }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        throw std::runtime_error("'" + interpreter + "' failed on " + script);
+    }
+    return {std::chrono::duration<double, std::milli>(elapsed).count(), usage.ru_maxrss};
+}
+
+// Nearest-rank percentile over sorted samples.
+static double percentile(const std::vector<double> &sorted, const double p) {
+    const size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(sorted.size())));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+static Result measure(const std::string &interpreter, const std::string &engine, const std::string &script, const int runs) {
+    std::vector<double> times;
+    long peak_rss_kb = 0;
+    for (int i = 0; i < runs; ++i) {
+        const Sample sample = runOnce(interpreter, engine, script);
+        times.push_back(sample.ms);
+        peak_rss_kb = std::max(peak_rss_kb, sample.peak_rss_kb);
+    }
+    std::sort(times.begin(), times.end());
+    return {benchName(script), percentile(times, 50), percentile(times, 95), peak_rss_kb};
+}
+
+// Reads the median of every benchmark from a file this tool wrote earlier. Only its own
+// output format is understood: one benchmark object per line.
+static std::map<std::string, double> readBaseline(const std::string &path) {
+    std::ifstream file(path);
+    if (!file.is_open()) { throw std::runtime_error("Failed to open baseline " + path); }
+
+    std::map<std::string, double> medians;
+    std::string line;
+    while (std::getline(file, line)) {
+        const size_t name_key = line.find("\"name\": \"");
+        const size_t median_key = line.find("\"median_ms\": ");
+        if (name_key == std::string::npos || median_key == std::string::npos) { continue; }
+        const size_t name_start = name_key + 9;
+        const std::string name = line.substr(name_start, line.find('"', name_start) - name_start);
+        medians[name] = std::strtod(line.c_str() + median_key + 13, nullptr);
+    }
+    return medians;
+}
+
+static std::string toJson(const std::string &interpreter, const std::string &engine, const int runs,
+                          const std::vector<Result> &results, const std::map<std::string, double> &baseline) {
+    std::ostringstream out;
+    out.setf(std::ios::fixed);
+    out.precision(3);
+    out << "{\n";
+    out << "  \"interpreter\": \"" << interpreter << "\",\n";
+    out << "  \"engine\": \"" << engine << "\",\n";
+    out << "  \"runs\": " << runs << ",\n";
+    out << "  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &result = results[i];
+        out << "    {\"name\": \"" << result.name << "\", \"median_ms\": " << result.median_ms
+            << ", \"p95_ms\": " << result.p95_ms << ", \"peak_rss_kb\": " << result.peak_rss_kb;
+        if (const auto it = baseline.find(result.name); it != baseline.end() && it->second > 0) {
+            out << ", \"baseline_median_ms\": " << it->second
+                << ", \"change_pct\": " << (result.median_ms - it->second) / it->second * 100.0;
+        }
+        out << "}" << (i + 1 < results.size() ? "," : "") << '\n';
+    }
+    out << "  ]\n}\n";
+    return out.str();
+}
+
+int main(int argc, char *argv[]) {
+    std::string interpreter;
+    std::string engine = "tree";
+    std::string baseline_path;
+    std::string output_path;
+    int runs = 5;
+    std::vector<std::string> scripts;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.starts_with("--interpreter=")) {
+            interpreter = arg.substr(14);
+        } else if (arg.starts_with("--engine=")) {
+            engine = arg.substr(9);
+        } else if (arg.starts_with("--runs=")) {
+            runs = std::max(1, std::atoi(arg.c_str() + 7));
+        } else if (arg.starts_with("--baseline=")) {
+            baseline_path = arg.substr(11);
+        } else if (arg.starts_with("--output=")) {
+            output_path = arg.substr(9);
+        } else if (!arg.starts_with("--")) {
+            scripts.push_back(arg);
+        } else {
+            std::cerr << "Unknown option " << arg << '\n';
+            return 64;
+        }
+    }
+    if (interpreter.empty() || scripts.empty()) {
+        std::cerr << "Usage: " << argv[0] << " --interpreter=PATH [--engine=tree|vm|closure] [--runs=N]"
+                  << " [--baseline=FILE] [--output=FILE] script.lox...\n";
+        return 64;
+    }
+
+    try {
+        const auto baseline = baseline_path.empty() ? std::map<std::string, double>{} : readBaseline(baseline_path);
+        std::sort(scripts.begin(), scripts.end());
+
+        std::vector<Result> results;
+        for (const auto &script : scripts) {
+            results.push_back(measure(interpreter, engine, script, runs));
+        }
+
+        const std::string json = toJson(interpreter, engine, runs, results, baseline);
+        std::cout << json;
+        if (!output_path.empty()) {
+            std::ofstream(output_path) << json;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "lox_bench: " << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator for AST nodes. Everything allocated from one Arena is released together when
+// it is destroyed, so only trivially destructible types may live in it.
+class Arena {
+    private:
+        static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+        std::vector<std::unique_ptr<std::byte[]>> m_blocks;
+        std::byte* m_cursor = nullptr;
+        std::byte* m_end = nullptr;
+        size_t m_bytes_used = 0;
+
+        void* allocate(const size_t size, const size_t align) {
+            auto aligned = (reinterpret_cast<uintptr_t>(m_cursor) + align - 1) & ~(uintptr_t{align} - 1);
+            if (!m_cursor || aligned + size > reinterpret_cast<uintptr_t>(m_end)) {
+                const size_t block_size = std::max(BLOCK_SIZE, size + align);
+                m_blocks.push_back(std::make_unique_for_overwrite<std::byte[]>(block_size));
+                m_cursor = m_blocks.back().get();
+                m_end = m_cursor + block_size;
+                aligned = (reinterpret_cast<uintptr_t>(m_cursor) + align - 1) & ~(uintptr_t{align} - 1);
+            }
+            m_cursor = reinterpret_cast<std::byte*>(aligned + size);
+            m_bytes_used += size;
+            return reinterpret_cast<void*>(aligned);
+        }
+
+    public:
+        Arena() = default;
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        template<typename T, typename ... Args>
+        T* make(Args&& ... args) {
+            static_assert(std::is_trivially_destructible_v<T>, "Arena objects are never destroyed individually");
+            return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        // Copies a temporary list built while parsing into the arena.
+        template<typename T>
+        std::span<const T> array(const std::vector<T>& items) {
+            static_assert(std::is_trivially_destructible_v<T> && std::is_trivially_copyable_v<T>);
+            if (items.empty()) { return {}; }
+            auto* data = static_cast<T*>(allocate(sizeof(T) * items.size(), alignof(T)));
+            std::uninitialized_copy(items.begin(), items.end(), data);
+            return {data, items.size()};
+        }
+
+        // A point to rewind() to. Everything allocated after it is freed by the rewind, so none
+        // of it may be referenced afterwards.
+        struct Mark {
+            size_t blocks;
+            std::byte* cursor;
+            std::byte* end;
+            size_t bytes_used;
+        };
+
+        [[nodiscard]] Mark mark() const { return {m_blocks.size(), m_cursor, m_end, m_bytes_used}; }
+
+        void rewind(const Mark& mark) {
+            m_blocks.resize(mark.blocks);
+            m_cursor = mark.cursor;
+            m_end = mark.end;
+            m_bytes_used = mark.bytes_used;
+        }
+
+        [[nodiscard]] size_t bytesUsed() const { return m_bytes_used; }
+};
+
+#endif //ARENA_HPP
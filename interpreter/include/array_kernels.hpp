@@ -0,0 +1,29 @@
+
+#ifndef ARRAY_KERNELS_HPP
+#define ARRAY_KERNELS_HPP
+
+#pragma once
+
+#include <cstddef>
+
+// Bulk loops behind the Array builtins. As with the scan kernels, the implementation is picked
+// once at startup: AVX2 on x86-64 CPUs that have it, otherwise portable scalar loops. Both
+// accumulate sums in four interleaved lanes combined the same way, so a script gets the same
+// bits from either; they just differ from a strict left-to-right sum in the last place.
+struct ArrayKernels {
+    double (*sum)(const double* values, size_t count);
+    // Of a non-empty array; NaN if any element is NaN.
+    double (*min)(const double* values, size_t count);
+    double (*max)(const double* values, size_t count);
+    double (*dot)(const double* lhs, const double* rhs, size_t count);
+    void (*scale)(const double* values, double factor, double* out, size_t count);
+    void (*add)(const double* lhs, const double* rhs, double* out, size_t count);
+    // out[i] = values[0] + ... + values[i].
+    void (*prefixSum)(const double* values, double* out, size_t count);
+    // "avx2" or "scalar".
+    const char* name;
+};
+
+const ArrayKernels& arrayKernels();
+
+#endif //ARRAY_KERNELS_HPP
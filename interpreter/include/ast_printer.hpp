@@ -5,14 +5,17 @@
 #pragma once
 
 #include "expr.hpp"
+#include <initializer_list>
 #include <string>
+#include <string_view>
 
 class Ast_Printer : public Expr_Visitor {
     private:
         std::string m_output;
-        std::string parenthesize(const std::string& name, const std::vector<std::shared_ptr<Expr>>& exprs);
+        std::string parenthesize(std::string_view name, std::initializer_list<const Expr*> exprs);
+        std::string parenthesize(std::string_view name, ExprList exprs);
     public:
-        std::string print(const std::shared_ptr<Expr>& expr);
+        std::string print(const Expr& expr);
 
         void visitBinaryExpr(const Binary_Expr& expr) override;
         void visitGroupingExpr(const Grouping_Expr& expr) override;
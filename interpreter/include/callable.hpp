@@ -7,26 +7,42 @@
 #include "statement.hpp"
 #include "token.hpp"
 #include "interpreter.hpp"
+#include "memo.hpp"
 
-#include <vector>
+#include <span>
 
 
-class LoxCallable {
+class LoxCallable : public Obj {
     public:
+        LoxCallable() : Obj(ObjType::CALLABLE) {}
         virtual size_t arity() const = 0;
-        virtual OptionalLiteral call(Interpreter &interpreter, const std::vector<OptionalLiteral>& arguments) = 0;
-        virtual ~LoxCallable() = default;
+        // `arguments` lives on the interpreter's value stack and is only valid until the callee
+        // starts evaluating code.
+        virtual Value call(Interpreter &interpreter, std::span<const Value> arguments) = 0;
 };
 
+// A closure: the declaration, shared by every closure made from it, plus a box for each
+// variable in m_declaration.m_captures. Interpreter::visitFunctionStmt fills m_upvalues.
 class LoxFunction : public LoxCallable {
     public:
-        Function_Stmt m_declaration;
-        std::shared_ptr<Environment> m_closure;
+        const Function_Stmt& m_declaration;
+        std::vector<ObjUpvalue*> m_upvalues;
+        // Where results are cached, for a pure function under --memo.
+        MemoTable* m_memo;
 
-        explicit LoxFunction(Function_Stmt declaration, std::shared_ptr<Environment> closure)
-            : m_declaration(std::move(declaration)), m_closure(std::move(closure)) {}
+        explicit LoxFunction(const Function_Stmt& declaration, MemoTable* memo = nullptr)
+            : m_declaration(declaration), m_memo(memo) { m_upvalues.reserve(declaration.m_captures.size()); }
         [[nodiscard]] size_t arity() const override { return m_declaration.m_arguments.size(); }
-        OptionalLiteral call(Interpreter &interpreter, const std::vector<OptionalLiteral>& arguments) override;
+        Value call(Interpreter &interpreter, std::span<const Value> arguments) override;
+        void trace(Heap& heap) override {
+            for (ObjUpvalue* upvalue : m_upvalues) { heap.mark(upvalue); }
+        }
+        [[nodiscard]] size_t byteSize() const override {
+            return sizeof(LoxFunction) + m_upvalues.capacity() * sizeof(ObjUpvalue*);
+        }
+
+    private:
+        Value run(Interpreter &interpreter, std::span<const Value> arguments) const;
 };
 
 #endif //CALLABLE_HPP
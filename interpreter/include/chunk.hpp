@@ -0,0 +1,119 @@
+
+#ifndef CHUNK_HPP
+#define CHUNK_HPP
+
+#pragma once
+
+#include "token.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Function_Stmt;
+class VmFunction;
+
+// Operands that index the constants, names or functions of a chunk are u16; each such op has
+// a *_LONG form taking a u24 for chunks with more than that.
+enum class OpCode : uint8_t {
+    CONSTANT,       // u16 constant index
+    CONSTANT_LONG,  // u24 constant index
+    NIL,
+    TRUE,
+    FALSE,
+    POP,
+
+    GET_LOCAL,      // u16 slot
+    SET_LOCAL,      // u16 slot
+    GET_GLOBAL,     // u16 name index
+    GET_GLOBAL_LONG,
+    DEFINE_GLOBAL,  // u16 name index
+    DEFINE_GLOBAL_LONG,
+    SET_GLOBAL,     // u16 name index
+    SET_GLOBAL_LONG,
+    GET_UPVALUE,    // u16 upvalue index
+    SET_UPVALUE,    // u16 upvalue index
+    CLOSE_UPVALUE,
+
+    EQUAL, NOT_EQUAL,
+    GREATER, GREATER_EQUAL,
+    LESS, LESS_EQUAL,
+    ADD, SUBTRACT, MULTIPLY, DIVIDE,
+    NOT, NEGATE,
+    INCREMENT, DECREMENT,
+    CHECK_NUMBER,
+    ARRAY,          // u16 element count
+    GET_INDEX, SET_INDEX,
+
+    PRINT,
+    JUMP,           // u16 forward offset
+    JUMP_IF_FALSE,  // u16 forward offset, pops the condition
+    LOOP,           // u16 backward offset
+    CALL,           // u8 argument count
+    TAIL_CALL,      // u8 argument count; a CALL directly followed by RETURN
+    CLOSURE,        // u16 function index, then (u8 is_local, u16 index) per upvalue
+    CLOSURE_LONG,
+    RETURN,
+};
+
+class Chunk {
+    public:
+        std::vector<uint8_t> m_code;
+        std::vector<size_t> m_lines;
+        std::vector<Value> m_constants;
+        std::vector<const ObjString*> m_names;
+        std::vector<std::shared_ptr<VmFunction>> m_functions;
+
+        void write(const uint8_t byte, const size_t line) {
+            m_code.push_back(byte);
+            m_lines.push_back(line);
+        }
+
+        // Equal constants share an index. They are compared by bits: strings are interned, and
+        // 0 and -0 must stay apart.
+        size_t addConstant(const Value value) {
+            const auto [it, inserted] = m_constant_index.try_emplace(std::bit_cast<uint64_t>(value), m_constants.size());
+            if (inserted) { m_constants.push_back(value); }
+            return it->second;
+        }
+
+        size_t addName(const ObjString* name) {
+            const auto [it, inserted] = m_name_index.try_emplace(name, m_names.size());
+            if (inserted) { m_names.push_back(name); }
+            return it->second;
+        }
+
+        size_t addFunction(std::shared_ptr<VmFunction> function) {
+            m_functions.push_back(std::move(function));
+            return m_functions.size() - 1;
+        }
+
+    private:
+        std::unordered_map<uint64_t, size_t> m_constant_index;
+        std::unordered_map<const ObjString*, size_t> m_name_index;
+};
+
+// The compiled form of a Function_Stmt (or of a whole script when m_name is empty).
+// Closures created at runtime share one VmFunction.
+class VmFunction {
+    public:
+        std::string m_name;
+        size_t m_line {};
+        size_t m_arity {};
+        size_t m_upvalue_count {};
+        size_t m_max_stack {};
+        // What it was compiled from, null for a script. The AST outlives every VmFunction made
+        // from it, so memo tables and profiler records are keyed by this rather than by the
+        // VmFunction.
+        const Function_Stmt* m_declaration = nullptr;
+        // Copied from Function_Stmt::m_pure and m_memo_deps.
+        bool m_pure = false;
+        std::span<const ObjString* const> m_memo_deps;
+        Chunk m_chunk;
+};
+
+#endif //CHUNK_HPP
@@ -0,0 +1,143 @@
+
+#ifndef CLOSURE_ENGINE_HPP
+#define CLOSURE_ENGINE_HPP
+
+#pragma once
+
+#include "callable.hpp"
+#include "environment.hpp"
+#include "frame_stack.hpp"
+#include "interpreter.hpp"
+#include "memo.hpp"
+#include "profiler.hpp"
+#include "statement.hpp"
+
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// A node compiled by ClosureEngine: an expression returns its value, a statement how it finished.
+using CompiledExpr = std::function<Value()>;
+using CompiledStmt = std::function<Interpreter::Completion()>;
+
+// A function declaration compiled once; every closure made from it runs m_body.
+struct CompiledFunction {
+    const Function_Stmt& m_declaration;
+    CompiledStmt m_body;
+};
+
+// A closure of the closure engine: the compiled function plus a box for each variable in
+// m_declaration.m_captures, as for LoxFunction.
+class ClosureFunction final : public LoxCallable {
+    public:
+        const CompiledFunction& m_function;
+        std::vector<ObjUpvalue*> m_upvalues;
+        // Where results are cached, for a pure function under --memo.
+        MemoTable* m_memo;
+
+        ClosureFunction(const CompiledFunction& function, MemoTable* memo) : m_function(function), m_memo(memo) {
+            m_upvalues.reserve(function.m_declaration.m_captures.size());
+        }
+        [[nodiscard]] size_t arity() const override { return m_function.m_declaration.m_arguments.size(); }
+        Value call(Interpreter &interpreter, std::span<const Value> arguments) override;
+        void trace(Heap& heap) override {
+            for (ObjUpvalue* upvalue : m_upvalues) { heap.mark(upvalue); }
+        }
+        [[nodiscard]] size_t byteSize() const override {
+            return sizeof(ClosureFunction) + m_upvalues.capacity() * sizeof(ObjUpvalue*);
+        }
+};
+
+// The middle tier behind --engine=closure. Each statement tree is walked once and every node
+// becomes a C++ closure with its children already bound, chosen by operator and, for binary
+// operators, by operand shape (a constant, a local slot or anything else); running the
+// program is calling those closures, which return their results directly rather than through
+// a visitor and a shared result slot. The runtime model is the tree-walker's: the Resolver's
+// slots in a value stack, upvalue boxes for captured variables, globals by name.
+class ClosureEngine final : public GcRoots, Expr_Visitor, Stmt_Visitor {
+    public:
+        using Completion = Interpreter::Completion;
+
+        ClosureEngine();
+        ~ClosureEngine() override { heap().removeRoots(this); }
+        ClosureEngine(const ClosureEngine&) = delete;
+        ClosureEngine& operator=(const ClosureEngine&) = delete;
+
+        void interpret(StmtList statements);
+        void markRoots(Heap& heap) override;
+        void setProfiler(Profiler* profiler) { m_profiler = profiler; }
+        void setMemoizer(Memoizer* memoizer) {
+            m_memoizer = memoizer;
+            m_globals->setMemoizer(memoizer);
+        }
+
+    private:
+        // Binary operand shapes; see binary().
+        struct Constant;
+        struct Local;
+        struct Any;
+
+        Environment* m_globals = heap().make<Environment>();
+        // The locals, laid out as in the Interpreter.
+        FrameStack m_frames;
+        // Operands and callees held while evaluating the rest of an expression.
+        std::vector<Value> m_temps;
+        // The value of the last RETURN, and the pending tail call.
+        Value m_return{};
+        ClosureFunction* m_tail_function = nullptr;
+        std::vector<Value> m_tail_arguments;
+        std::vector<Value> m_memo_keys;
+        Profiler* m_profiler = nullptr;
+        Memoizer* m_memoizer = nullptr;
+        size_t m_profiler_depth = 0;
+
+        // Every function compiled so far, by declaration; closures refer to these.
+        std::unordered_map<const Function_Stmt*, std::unique_ptr<CompiledFunction>> m_functions;
+        // Compiler state: the node just compiled, and how many function bodies enclose it.
+        CompiledExpr m_expr;
+        CompiledStmt m_stmt;
+        size_t m_function_depth = 0;
+
+        CompiledExpr compile(const Expr* expr);
+        CompiledStmt compile(Stmt* stmt);
+        CompiledStmt compile(StmtList statements);
+        template<Value (*Op)(Value, Value)> CompiledExpr binary(const Binary_Expr& expr);
+        template<Value (*Op)(Value, Value), typename Left, typename Right> CompiledExpr binary(Left left, Right right);
+        CompiledExpr call(const Call_Expr& expr);
+        CompiledStmt tailCall(const Call_Expr& expr);
+
+        void visitBinaryExpr(const Binary_Expr &expr) override;
+        void visitGroupingExpr(const Grouping_Expr &expr) override;
+        void visitLiteralExpr(const Literal_Expr &expr) override;
+        void visitUnaryExpr(const Unary_Expr &expr) override;
+        void visitVariableExpr(const Variable_Expr &expr) override;
+        void visitAssignExpr(const Assign_Expr &expr) override;
+        void visitCallExpr(const Call_Expr &expr) override;
+        void visitArrayExpr(const Array_Expr &expr) override;
+        void visitIndexExpr(const Index_Expr &expr) override;
+        void visitIndexSetExpr(const IndexSet_Expr &expr) override;
+
+        void visitExpressionStmt(const Expression_Stmt &stmt) override;
+        void visitPrintStmt(const Print_Stmt &stmt) override;
+        void visitVarStmt(const Var_Stmt &stmt) override;
+        void visitBlockStmt(const Block_Stmt &stmt) override;
+        void visitIfStmt(const If_Stmt &stmt) override;
+        void visitWhileStmt(const While_Stmt &stmt) override;
+        void visitForStmt(const For_Stmt &stmt) override;
+        void visitFunctionStmt(const Function_Stmt &stmt) override;
+        void visitReturnStmt(const Return_Stmt &stmt) override;
+        void visitBreakStmt(const Break_Stmt &stmt) override;
+        void visitContinueStmt(const Continue_Stmt &stmt) override;
+
+        // Runtime support for the compiled closures. Calls `callee` with the `count` arguments on
+        // top of the stack, checked as the tree-walker checks them.
+        Value callValue(Value callee, size_t count, size_t call_line);
+        Value callFunction(ClosureFunction& function, size_t base);
+        Completion execute(const ClosureFunction& function, size_t base);
+        // The profiler's id for `function`.
+        size_t profilerId(const ClosureFunction& function) const;
+        void reset();
+};
+
+#endif //CLOSURE_ENGINE_HPP
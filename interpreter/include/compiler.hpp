@@ -0,0 +1,101 @@
+
+#ifndef COMPILER_HPP
+#define COMPILER_HPP
+
+#pragma once
+
+#include "chunk.hpp"
+#include "expr.hpp"
+#include "statement.hpp"
+
+#include <memory>
+#include <vector>
+
+// Lowers the Stmt/Expr trees produced by Parser::parse() into bytecode for the VM.
+class Compiler : public Expr_Visitor, public Stmt_Visitor {
+    public:
+        std::shared_ptr<VmFunction> compile(StmtList statements);
+
+        void visitBinaryExpr(const Binary_Expr &expr) override;
+        void visitGroupingExpr(const Grouping_Expr &expr) override;
+        void visitLiteralExpr(const Literal_Expr &expr) override;
+        void visitUnaryExpr(const Unary_Expr &expr) override;
+        void visitVariableExpr(const Variable_Expr &expr) override;
+        void visitAssignExpr(const Assign_Expr &expr) override;
+        void visitCallExpr(const Call_Expr &expr) override;
+        void visitArrayExpr(const Array_Expr &expr) override;
+        void visitIndexExpr(const Index_Expr &expr) override;
+        void visitIndexSetExpr(const IndexSet_Expr &expr) override;
+
+        void visitExpressionStmt(const Expression_Stmt &stmt) override;
+        void visitPrintStmt(const Print_Stmt &stmt) override;
+        void visitVarStmt(const Var_Stmt &stmt) override;
+        void visitBlockStmt(const Block_Stmt &stmt) override;
+        void visitIfStmt(const If_Stmt &stmt) override;
+        void visitWhileStmt(const While_Stmt &stmt) override;
+        void visitForStmt(const For_Stmt &stmt) override;
+        void visitFunctionStmt(const Function_Stmt &stmt) override;
+        void visitReturnStmt(const Return_Stmt &stmt) override;
+        void visitBreakStmt(const Break_Stmt &stmt) override;
+        void visitContinueStmt(const Continue_Stmt &stmt) override;
+
+    private:
+        struct Local {
+            const ObjString* name;
+            int depth;
+            bool captured;
+        };
+
+        struct Upvalue {
+            uint16_t index;
+            bool is_local;
+        };
+
+        // Forward jumps out of a loop body, patched once the loop's exit and step are known.
+        struct Loop {
+            int scope_depth;
+            std::vector<size_t> break_jumps;
+            std::vector<size_t> continue_jumps;
+        };
+
+        struct FunctionState {
+            std::shared_ptr<VmFunction> function;
+            FunctionState* enclosing;
+            std::vector<Local> locals;
+            std::vector<Upvalue> upvalues;
+            int scope_depth;
+            size_t stack_depth;
+            std::vector<Loop> loops;
+        };
+
+        FunctionState* m_current = nullptr;
+        size_t m_line = 0;
+
+        Chunk& chunk() const { return m_current->function->m_chunk; }
+        void emit(OpCode op, int stack_effect);
+        void emitByte(uint8_t byte);
+        void emitShort(size_t value);
+        // `op` with a constant, name or function `index`, or `long_op` when it does not fit a u16.
+        void emitIndexed(OpCode op, OpCode long_op, int stack_effect, size_t index);
+        size_t emitJump(OpCode op, int stack_effect);
+        void patchJump(size_t offset);
+        void emitLoop(size_t loop_start);
+        void emitLoopExit(std::vector<size_t> Loop::* jumps);
+        // CALL or TAIL_CALL, after the callee and arguments.
+        void emitCall(const Call_Expr& expr, OpCode op);
+
+        void beginScope();
+        void endScope();
+        void compileFunction(const Function_Stmt& stmt);
+        void declareVariable(const ObjString* name);
+        void defineVariable(const ObjString* name);
+        [[nodiscard]] int resolveInScope(const ObjString* name) const;
+        void emitGet(const Identifier& name);
+        void emitSet(const Identifier& name);
+
+        static int resolveLocal(const FunctionState& state, const ObjString* name);
+        static int resolveUpvalue(FunctionState& state, const ObjString* name);
+        static int addUpvalue(FunctionState& state, uint16_t index, bool is_local);
+};
+
+#endif //COMPILER_HPP
@@ -1,42 +1,81 @@
-
 #ifndef ENVIRONMENT_HPP
 #define ENVIRONMENT_HPP
 
 #include <unordered_map>
 #include <string>
 
+#include "memo.hpp"
 #include "token.hpp"
 
-class Environment {
+// A variable some closure captured, moved out of its stack slot into its own box. The slot
+// then refers to the box, so the scope and every closure capturing the variable share it.
+class ObjUpvalue final : public Obj {
+    public:
+        Value m_value;
+
+        explicit ObjUpvalue(const Value value) : Obj(ObjType::UPVALUE), m_value(value) {}
+
+        void trace(Heap& heap) override { heap.mark(m_value); }
+        [[nodiscard]] size_t byteSize() const override { return sizeof(ObjUpvalue); }
+};
+
+// The global variables, by interned name. Locals live in the interpreter's value stack,
+// in the slots the Resolver assigned; see FrameStack.
+class Environment final : public Obj {
     private:
-        std::unordered_map<std::string, OptionalLiteral> m_variables;
-        std::shared_ptr<Environment> m_parent;
+        // Versions are drawn from one counter, so no two environments ever share one.
+        static inline uint64_t s_versions = 0;
+
+        std::unordered_map<const ObjString*, Value, ObjStringHash> m_variables;
+        uint64_t m_version = ++s_versions;
+        Memoizer* m_memoizer = nullptr;
+
+        // Replacing a callable moves to a new version, which drops every call-site cache
+        // holding it (see Call_Expr), and retires the memo tables of the functions calling it.
+        void overwrite(const ObjString* name, Value& variable, const Value value) {
+            if (variable.isCallable()) {
+                m_version = ++s_versions;
+                if (m_memoizer) { m_memoizer->rebound(name); }
+            }
+            variable = value;
+        }
 
     public:
-        Environment() = default;
+        Environment() : Obj(ObjType::ENVIRONMENT) {}
 
-        explicit Environment(std::shared_ptr<Environment> parent) : m_parent(std::move(parent)) {}
+        void trace(Heap& heap) override {
+            // Names are usually pinned identifiers, but not those --stream has released.
+            for (const auto& [name, value] : m_variables) {
+                heap.mark(const_cast<ObjString*>(name));
+                heap.mark(value);
+            }
+        }
 
-        void define(const std::string& name, const OptionalLiteral& value) { m_variables[name] = value; }
+        // Must not change over the object's lifetime, so named variables aren't counted.
+        [[nodiscard]] size_t byteSize() const override { return sizeof(Environment); }
 
-        [[nodiscard]] OptionalLiteral get(const Token& name) const {
-            if (const auto it = m_variables.find(name.lexeme()); it != m_variables.end()) {
-                return it->second;
+        [[nodiscard]] uint64_t version() const { return m_version; }
+        void setMemoizer(Memoizer* memoizer) { m_memoizer = memoizer; }
+
+        void define(const ObjString* name, const Value value) {
+            if (const auto [it, inserted] = m_variables.try_emplace(name, value); !inserted) {
+                overwrite(name, it->second, value);
             }
-            if (m_parent) { return m_parent->get(name); }
-            throw std::runtime_error("Undefined variable '" + name.lexeme() + "'.");
         }
 
-        void assign(const Token& name, const OptionalLiteral& value) {
-            if (const auto it = m_variables.find(name.lexeme()); it != m_variables.end()) {
-                m_variables[name.lexeme()] = value;
-                return;
+        [[nodiscard]] Value get(const Identifier& name) const {
+            if (const auto it = m_variables.find(name.name()); it != m_variables.end()) {
+                return it->second;
             }
-            if (m_parent) {
-                m_parent->assign(name, value);
+            throw std::runtime_error("Undefined variable '" + name.name()->m_chars + "'.");
+        }
+
+        void assign(const Identifier& name, const Value value) {
+            if (const auto it = m_variables.find(name.name()); it != m_variables.end()) {
+                overwrite(name.name(), it->second, value);
                 return;
             }
-            throw std::runtime_error("Undefined variable '" + name.lexeme() + "'.");
+            throw std::runtime_error("Undefined variable '" + name.name()->m_chars + "'.");
         }
 };
 
@@ -6,9 +6,10 @@
 
 #include "token.hpp"
 
-#include <memory>
-#include <vector>
+#include <cstdint>
+#include <span>
 
+class LoxCallable;
 class Binary_Expr;
 class Grouping_Expr;
 class Literal_Expr;
@@ -16,6 +17,9 @@ class Unary_Expr;
 class Variable_Expr;
 class Assign_Expr;
 class Call_Expr;
+class Array_Expr;
+class Index_Expr;
+class IndexSet_Expr;
 
 class Expr_Visitor {
     public:
@@ -26,22 +30,43 @@ class Expr_Visitor {
         virtual void visitVariableExpr(const Variable_Expr& expr) = 0;
         virtual void visitAssignExpr(const Assign_Expr& expr) = 0;
         virtual void visitCallExpr(const Call_Expr& expr) = 0;
+        virtual void visitArrayExpr(const Array_Expr& expr) = 0;
+        virtual void visitIndexExpr(const Index_Expr& expr) = 0;
+        virtual void visitIndexSetExpr(const IndexSet_Expr& expr) = 0;
         virtual ~Expr_Visitor() = default;
 };
 
+// Nodes are allocated in a Program's Arena and freed with it, never through a base pointer.
 class Expr {
     public:
-        virtual ~Expr() = default;
         virtual void accept(Expr_Visitor& visitor) const = 0;
+
+    protected:
+        ~Expr() = default;
 };
 
+using ExprList = std::span<Expr* const>;
+
 class Binary_Expr final : public Expr {
 public:
-    std::shared_ptr<Expr> m_left, m_right;
+    // The evaluator this site specialized itself to, from the operands the tree-walker saw on
+    // its first run: NUMBER_* for two numbers, STRING_CONCAT for two strings. GENERIC once it
+    // meets operands its specialization doesn't cover, which it then keeps.
+    enum class Quick : uint8_t {
+        UNSEEN, GENERIC,
+        NUMBER_ADD, NUMBER_SUBTRACT, NUMBER_MULTIPLY, NUMBER_DIVIDE,
+        NUMBER_LESS, NUMBER_LESS_EQUAL, NUMBER_GREATER, NUMBER_GREATER_EQUAL,
+        NUMBER_EQUAL, NUMBER_NOT_EQUAL,
+        STRING_CONCAT,
+    };
+
+    Expr* m_left;
+    Expr* m_right;
     Token m_op;
+    mutable Quick m_quick = Quick::UNSEEN;
 
-    Binary_Expr(std::shared_ptr<Expr> left, Token op, std::shared_ptr<Expr> right)
-        : m_left(std::move(left)), m_right(std::move(right)), m_op(std::move(op)) {}
+    Binary_Expr(Expr* left, const Token& op, Expr* right)
+        : m_left(left), m_right(right), m_op(op) {}
 
     void accept(Expr_Visitor &visitor) const override {
         visitor.visitBinaryExpr(*this);
@@ -50,9 +75,9 @@ public:
 
 class Grouping_Expr final : public Expr {
 public:
-    std::vector<std::shared_ptr<Expr>> m_exprs;
-    explicit Grouping_Expr(std::vector<std::shared_ptr<Expr>> exprs)
-        :m_exprs(std::move(exprs)) {}
+    ExprList m_exprs;
+    explicit Grouping_Expr(const ExprList exprs)
+        :m_exprs(exprs) {}
 
     void accept(Expr_Visitor &visitor) const override {
         visitor.visitGroupingExpr(*this);
@@ -61,8 +86,8 @@ public:
 
 class Literal_Expr final : public Expr {
 public:
-    OptionalLiteral m_value;
-    explicit Literal_Expr(OptionalLiteral value) : m_value(std::move(value)) {}
+    Value m_value;
+    explicit Literal_Expr(const Value value) : m_value(value) {}
 
     void accept(Expr_Visitor &visitor) const override {
         visitor.visitLiteralExpr(*this);
@@ -71,11 +96,14 @@ public:
 
 class Unary_Expr final : public Expr {
 public:
-    std::shared_ptr<Expr> m_operand;
+    Expr* m_operand;
     Token m_op;
+    // Set by the Resolver for '++'/'--' on a variable; see Variable_Expr.
+    mutable int m_depth = -1;
+    mutable size_t m_slot = 0;
 
-    Unary_Expr(std::shared_ptr<Expr> operand, Token op)
-        :m_operand(std::move(operand)), m_op(op) {}
+    Unary_Expr(Expr* operand, const Token& op)
+        :m_operand(operand), m_op(op) {}
     void accept(Expr_Visitor &visitor) const override {
         visitor.visitUnaryExpr(*this);
     }
@@ -83,17 +111,24 @@ public:
 
 class Variable_Expr final : public Expr {
     public:
-        Token m_name;
-        explicit Variable_Expr(Token name) : m_name(std::move(name)) {}
+        Identifier m_name;
+        // Set by the Resolver: with a depth of 0 the variable is in slot m_slot of the running
+        // call's frame, with 1 it is the running function's upvalue m_slot, and with -1 it is
+        // looked up by name in the globals.
+        mutable int m_depth = -1;
+        mutable size_t m_slot = 0;
+        explicit Variable_Expr(const Identifier& name) : m_name(name) {}
         void accept(Expr_Visitor &visitor) const override { visitor.visitVariableExpr(*this); }
 };
 
 class Assign_Expr final : public Expr {
     public:
-        Token m_name;
-        std::shared_ptr<Expr> m_value;
+        Identifier m_name;
+        Expr* m_value;
+        mutable int m_depth = -1;
+        mutable size_t m_slot = 0;
 
-        Assign_Expr(Token name, std::shared_ptr<Expr> value) : m_name(std::move(name)), m_value(std::move(value)) {}
+        Assign_Expr(const Identifier& name, Expr* value) : m_name(name), m_value(value) {}
 
         void accept(Expr_Visitor &visitor) const override {
             visitor.visitAssignExpr(*this);
@@ -102,13 +137,53 @@ class Assign_Expr final : public Expr {
 
 class Call_Expr final : public Expr {
     public:
-        std::shared_ptr<Expr> m_callee;
+        Expr* m_callee;
         Token m_paren;
-        std::vector<std::shared_ptr<Expr>> m_args;
-
-    Call_Expr(std::shared_ptr<Expr> callee, Token paren, std::vector<std::shared_ptr<Expr>> args)
-        :m_callee(std::move(callee)), m_paren(std::move(paren)), m_args(std::move(args)) {}
+        ExprList m_args;
+        // The tree-walker's inline cache for a global callee: what the name held when last
+        // called here, with its arity already checked, valid while the globals are at
+        // m_cached_version. Version 0 is never current.
+        mutable LoxCallable* m_cached_callee = nullptr;
+        mutable uint64_t m_cached_version = 0;
+
+    Call_Expr(Expr* callee, const Token& paren, const ExprList args)
+        :m_callee(callee), m_paren(paren), m_args(args) {}
     void accept(Expr_Visitor &visitor) const override { visitor.visitCallExpr(*this); }
 };
 
+// `[a, b, c]`: a new array holding the elements' values.
+class Array_Expr final : public Expr {
+    public:
+        Token m_bracket;
+        ExprList m_elements;
+
+        Array_Expr(const Token& bracket, const ExprList elements) : m_bracket(bracket), m_elements(elements) {}
+        void accept(Expr_Visitor &visitor) const override { visitor.visitArrayExpr(*this); }
+};
+
+// `object[index]`
+class Index_Expr final : public Expr {
+    public:
+        Expr* m_object;
+        Token m_bracket;
+        Expr* m_index;
+
+        Index_Expr(Expr* object, const Token& bracket, Expr* index)
+            : m_object(object), m_bracket(bracket), m_index(index) {}
+        void accept(Expr_Visitor &visitor) const override { visitor.visitIndexExpr(*this); }
+};
+
+// `object[index] = value`, which evaluates to the value.
+class IndexSet_Expr final : public Expr {
+    public:
+        Expr* m_object;
+        Token m_bracket;
+        Expr* m_index;
+        Expr* m_value;
+
+        IndexSet_Expr(Expr* object, const Token& bracket, Expr* index, Expr* value)
+            : m_object(object), m_bracket(bracket), m_index(index), m_value(value) {}
+        void accept(Expr_Visitor &visitor) const override { visitor.visitIndexSetExpr(*this); }
+};
+
 #endif //EXPR_HPP
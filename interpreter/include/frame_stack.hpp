@@ -0,0 +1,133 @@
+#ifndef FRAME_STACK_HPP
+#define FRAME_STACK_HPP
+
+#pragma once
+
+#include "environment.hpp"
+#include "statement.hpp"
+
+#include <algorithm>
+#include <span>
+#include <vector>
+
+// The locals of the tree-walker and the closure engine. One value stack holds the frame of
+// every active call, each with the slots the Resolver assigned it, parameters first, and below
+// them the locals of blocks outside any function; arguments for the next call are pushed on
+// top. A slot holding an ObjUpvalue is a variable some closure captured: slot() and variable()
+// see through the box. The running function's own captures are its upvalue boxes; every
+// function with a frame on the stack is a root for as long as the frame is, since after a tail
+// call nothing else may hold it.
+class FrameStack {
+    public:
+        static constexpr size_t STACK_INITIAL = 1024;
+
+        // Where the caller's frame was, to return to after a call.
+        struct Caller {
+            size_t frame;
+            std::span<ObjUpvalue* const> upvalues;
+        };
+
+        FrameStack() { m_values.reserve(STACK_INITIAL); }
+
+        [[nodiscard]] size_t size() const { return m_values.size(); }
+        void push(const Value value) { m_values.push_back(value); }
+        void truncate(const size_t size) { m_values.resize(size); }
+        // The `count` values on top of the stack.
+        [[nodiscard]] std::span<Value> top(const size_t count) { return {m_values.data() + size() - count, count}; }
+
+        // Makes `arguments` the start of a new frame and returns where it begins. Arguments
+        // already on top of the stack stay in place; others (a tail call's, or a native's calling
+        // back into Lox) are copied there.
+        size_t place(const std::span<const Value> arguments) {
+            if (arguments.data() + arguments.size() == m_values.data() + m_values.size()) {
+                return size() - arguments.size();
+            }
+            const size_t base = size();
+            m_values.insert(m_values.end(), arguments.begin(), arguments.end());
+            return base;
+        }
+
+        // Runs a call's frame from `base`, which has `scope_size` slots, for `function`, whose
+        // captured variables are `upvalues`.
+        Caller enter(const size_t base, const size_t scope_size, const Obj& function,
+                     const std::span<ObjUpvalue* const> upvalues) {
+            const Caller caller{m_frame, m_upvalues};
+            m_frame = base;
+            m_upvalues = upvalues;
+            m_functions.push_back(&function);
+            m_values.resize(base + scope_size);
+            return caller;
+        }
+
+        // Drops the running frame and its arguments.
+        void leave(const Caller& caller) {
+            m_values.resize(m_frame);
+            m_frame = caller.frame;
+            m_upvalues = caller.upvalues;
+            m_functions.pop_back();
+        }
+
+        // Local variables: slot `index` of the running frame, and what a (depth, slot) pair from
+        // the Resolver refers to.
+        Value& slot(const size_t index) {
+            Value& value = m_values[m_frame + index];
+            return value.isObjType(ObjType::UPVALUE) ? static_cast<ObjUpvalue*>(value.asObj())->m_value : value;
+        }
+
+        Value& variable(const int depth, const size_t index) {
+            return depth == 0 ? slot(index) : captured(index);
+        }
+
+        // Variable `index` the running function captured.
+        [[nodiscard]] Value& captured(const size_t index) const { return m_upvalues[index]->m_value; }
+
+        // What the closure being made gets for `capture`; boxes a slot on first capture.
+        ObjUpvalue* upvalue(const Capture& capture) {
+            if (capture.depth != 0) { return m_upvalues[capture.slot]; }
+            Value& value = m_values[m_frame + capture.slot];
+            if (value.isObjType(ObjType::UPVALUE)) { return static_cast<ObjUpvalue*>(value.asObj()); }
+            auto* box = heap().make<ObjUpvalue>(value);
+            // make() may collect but never moves the stack, so `value` is still the slot.
+            value = Value::object(box);
+            return box;
+        }
+
+        // A call's frame already spans the slots of every block in it; only blocks outside any
+        // function may need the stack to grow.
+        void enterScope(const ScopeSlots& slots) {
+            if (m_values.size() < m_frame + slots.end) { m_values.resize(m_frame + slots.end); }
+        }
+
+        // Closures keep the boxes of the variables they captured; the slots start over unboxed.
+        void exitScope(const ScopeSlots& slots) {
+            if (slots.captured) {
+                std::fill(m_values.begin() + static_cast<ptrdiff_t>(m_frame + slots.begin),
+                          m_values.begin() + static_cast<ptrdiff_t>(m_frame + slots.end), Value::nil());
+            }
+        }
+
+        // Whatever blocks a top-level statement ran are over, so their slots are dead.
+        void clear() { m_values.clear(); }
+
+        // A runtime error abandons whatever was executing; the REPL continues at global scope.
+        void reset() {
+            m_values.clear();
+            m_frame = 0;
+            m_upvalues = {};
+            m_functions.clear();
+        }
+
+        void mark(Heap& heap) const {
+            for (const Value value : m_values) { heap.mark(value); }
+            for (const Obj* function : m_functions) { heap.mark(const_cast<Obj*>(function)); }
+        }
+
+    private:
+        std::vector<Value> m_values;
+        size_t m_frame = 0;
+        std::span<ObjUpvalue* const> m_upvalues;
+        // The function running each frame, innermost last.
+        std::vector<const Obj*> m_functions;
+};
+
+#endif //FRAME_STACK_HPP
@@ -8,10 +8,25 @@
 #include "statement.hpp"
 #include "token.hpp"
 #include "environment.hpp"
+#include "frame_stack.hpp"
+#include "profiler.hpp"
 
-class Interpreter : public Expr_Visitor, public Stmt_Visitor {
+#include <span>
+#include <vector>
+
+class LoxCallable;
+class LoxFunction;
+class Memoizer;
+
+class Interpreter final : public Expr_Visitor, public Stmt_Visitor, public GcRoots {
     public:
-        void interpret(const std::vector<std::shared_ptr<Stmt>>& statements);
+        Interpreter();
+        ~Interpreter() override { heap().removeRoots(this); }
+        Interpreter(const Interpreter&) = delete;
+        Interpreter& operator=(const Interpreter&) = delete;
+
+        void interpret(StmtList statements);
+        void markRoots(Heap& heap) override;
         void visitLiteralExpr(const Literal_Expr &expr) override;
         void visitUnaryExpr(const Unary_Expr &expr) override;
         void visitBinaryExpr(const Binary_Expr &expr) override;
@@ -21,32 +36,76 @@ class Interpreter : public Expr_Visitor, public Stmt_Visitor {
         void visitExpressionStmt(const Expression_Stmt &stmt) override;
         void visitVariableExpr(const Variable_Expr &stmt) override;
         void visitBlockStmt(const Block_Stmt &stmt) override;
-        void executeBlock(const std::vector<std::shared_ptr<Stmt>>& statements, std::shared_ptr<Environment> new_env);
+        // Runs the body of a call to `function` in a new frame holding `arguments`. Arguments on
+        // top of the value stack, where visitCallExpr leaves them, become the frame in place.
+        void executeCall(const LoxFunction& function, std::span<const Value> arguments);
+        void executeStatements(StmtList statements);
         void visitAssignExpr(const Assign_Expr &expr) override;
         void visitIfStmt(const If_Stmt &stmt) override;
         void visitWhileStmt(const While_Stmt &stmt) override;
         void visitForStmt(const For_Stmt &stmt) override;
         void visitFunctionStmt(const Function_Stmt &stmt) override;
         void visitCallExpr(const Call_Expr &expr) override;
+        void visitArrayExpr(const Array_Expr &expr) override;
+        void visitIndexExpr(const Index_Expr &expr) override;
+        void visitIndexSetExpr(const IndexSet_Expr &expr) override;
         void visitReturnStmt(const Return_Stmt &stmt) override;
+        void visitBreakStmt(const Break_Stmt &stmt) override;
+        void visitContinueStmt(const Continue_Stmt &stmt) override;
 
-        std::shared_ptr<Environment> environment() { return m_environment; }
+        // How the last statement finished. Anything but NORMAL unwinds the enclosing blocks
+        // until a loop (BREAK/CONTINUE) or LoxFunction::call (RETURN, value in m_result) takes it.
+        // TAIL_CALL is a `return f(...)` whose call is left for LoxFunction::call to make in
+        // place of the returning function, see takeTailCall().
+        enum class Completion { NORMAL, BREAK, CONTINUE, RETURN, TAIL_CALL };
 
-    private:
-        OptionalLiteral m_result{};
-        std::shared_ptr<Environment> m_globals = std::make_shared<Environment>();
-        std::shared_ptr<Environment> m_environment = m_globals;
+        [[nodiscard]] Completion completion() const { return m_completion; }
+        // Consumes a pending RETURN and yields its value.
+        Value takeReturnValue() {
+            m_completion = Completion::NORMAL;
+            return m_result;
+        }
+        // Consumes a pending TAIL_CALL and yields the function to run; its arguments stay in
+        // tailArguments() until the next tail call.
+        LoxFunction* takeTailCall() {
+            m_completion = Completion::NORMAL;
+            return m_tail_function;
+        }
+        [[nodiscard]] std::span<const Value> tailArguments() const { return m_tail_arguments; }
+        // The arguments of memoized calls in progress, kept as their keys; roots too.
+        std::vector<Value>& memoKeys() { return m_memo_keys; }
 
-        static bool isTruthy(const OptionalLiteral& val);
-        static bool isEqual(const OptionalLiteral& lhs, const OptionalLiteral& rhs);
-};
+        void setProfiler(Profiler* profiler) { m_profiler = profiler; }
+        void setMemoizer(Memoizer* memoizer) {
+            m_memoizer = memoizer;
+            m_globals->setMemoizer(memoizer);
+        }
 
-class ReturnException : public std::runtime_error {
-    public:
-        OptionalLiteral m_value;
+        static bool isTruthy(Value val);
+        static void print(Value value);
+
+    private:
+        bool loopBody(Stmt* body);
+        // The profiler's id for `callee`.
+        size_t profilerId(const LoxCallable& callee) const;
+        Value profiledCall(LoxCallable& callee, std::span<const Value> arguments, size_t call_line);
+        LoxCallable& evaluateCall(const Call_Expr& expr);
+        void tailCall(const Call_Expr& expr);
 
-        explicit ReturnException(OptionalLiteral value)
-            :std::runtime_error("Return"), m_value(std::move(value)) {}
+        Value m_result{};
+        Completion m_completion = Completion::NORMAL;
+        Profiler* m_profiler = nullptr;
+        Memoizer* m_memoizer = nullptr;
+        Environment* m_globals = heap().make<Environment>();
+        // The locals of the active calls and of blocks outside any function.
+        FrameStack m_frames;
+        // GC roots the C++ stack would otherwise hide: operands or arguments held while
+        // evaluating the rest of an expression.
+        std::vector<Value> m_temps;
+        // The pending (or last) tail call; roots too.
+        LoxFunction* m_tail_function = nullptr;
+        std::vector<Value> m_tail_arguments;
+        std::vector<Value> m_memo_keys;
 };
 
 #endif //INTERPRETER_HPP
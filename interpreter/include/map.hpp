@@ -0,0 +1,69 @@
+
+#ifndef MAP_HPP
+#define MAP_HPP
+
+#pragma once
+
+#include "value.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Hash map from strings, numbers and booleans to any value, laid out like a SwissTable: one
+// control byte per slot (empty, deleted, or 7 bits of the key's hash) scanned a 16-slot group
+// at a time, with linear probing from group to group. The slots only hold an index into a
+// dense entry array, so iteration walks contiguous memory, and the whole table costs 22 bytes
+// per entry at the maximum load of 7/8 (twice that just after growing). Removing an entry moves the last one into its place, so removals
+// reorder the entries seen through entry().
+class ObjMap final : public Obj {
+    public:
+        struct Entry {
+            Value key;
+            Value value;
+        };
+
+        ObjMap() : Obj(ObjType::MAP) {}
+
+        // Whether `key` may be used: a string, a boolean or a number other than NaN.
+        static bool isValidKey(const Value& key);
+
+        // The value stored under `key`, or null. String keys may be in either representation.
+        [[nodiscard]] const Value* find(const Value& key) const;
+        // Inserts or overwrites; returns whether the key was new. A string key must be interned,
+        // since the map keeps it.
+        bool set(const Value& key, const Value& value);
+        // Returns whether the key was present.
+        bool remove(const Value& key);
+
+        [[nodiscard]] size_t size() const { return m_entries.size(); }
+        [[nodiscard]] const Entry& entry(const size_t index) const { return m_entries[index]; }
+
+        void trace(Heap& heap) override;
+        // Grows with the table; rehash() reports each change to the Heap.
+        [[nodiscard]] size_t byteSize() const override {
+            return sizeof(ObjMap) + m_entries.capacity() * sizeof(Entry) + m_control.capacity() +
+                   m_slots.capacity() * sizeof(uint32_t);
+        }
+
+    private:
+        static constexpr size_t GROUP = 16;
+        static constexpr int8_t EMPTY = -128;
+        static constexpr int8_t DELETED = -2;
+        static constexpr size_t NOT_FOUND = SIZE_MAX;
+
+        std::vector<Entry> m_entries;
+        // One byte per slot: EMPTY, DELETED, or the low 7 bits of a full slot's hash.
+        std::vector<int8_t> m_control;
+        // For full slots, the index of their entry in m_entries.
+        std::vector<uint32_t> m_slots;
+        size_t m_deleted = 0;
+
+        static uint64_t hash(const Value& key);
+        [[nodiscard]] size_t findSlot(const Value& key, uint64_t hash) const;
+        [[nodiscard]] size_t freeSlot(uint64_t hash) const;
+        void rehash(size_t capacity);
+};
+
+inline ObjMap* Value::asMap() const { return static_cast<ObjMap*>(asObj()); }
+
+#endif //MAP_HPP
@@ -0,0 +1,86 @@
+
+#ifndef MEMO_HPP
+#define MEMO_HPP
+
+#pragma once
+
+#include "value.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Results of one pure function (see PurityAnalysis) keyed by its arguments. Only calls whose
+// arguments are all numbers, booleans, nil or strings are cached: those can't change under the
+// function, and numbers compare by bits so 0 and -0 stay apart. The table is open-addressed and
+// bounded; once it holds MAX_ENTRIES it starts over empty. A retired table is emptied and caches
+// nothing more, for a function whose callees were rebound.
+class MemoTable {
+    public:
+        static constexpr size_t MAX_ENTRIES = 1 << 16;
+
+        std::string m_name;
+        size_t m_line;
+        uint64_t m_hits = 0;
+        uint64_t m_misses = 0;
+
+        MemoTable(std::string name, size_t line, size_t arity);
+
+        static bool isKey(std::span<const Value> arguments);
+        // Whether a call with these arguments is looked up and cached here.
+        [[nodiscard]] bool caches(const std::span<const Value> arguments) const { return !m_retired && isKey(arguments); }
+        // The cached result for these arguments, or null; counts a hit or a miss.
+        const Value* find(std::span<const Value> arguments);
+        void insert(std::span<const Value> arguments, Value result);
+        void retire();
+
+        [[nodiscard]] size_t arity() const { return m_arity; }
+        [[nodiscard]] size_t size() const { return m_count; }
+        [[nodiscard]] bool retired() const { return m_retired; }
+        void trace(Heap& heap) const;
+
+    private:
+        size_t m_arity;
+        size_t m_count = 0;
+        bool m_retired = false;
+        // Each slot is arity + 1 values, the arguments and then the result.
+        std::vector<Value> m_slots;
+        std::vector<bool> m_used;
+
+        [[nodiscard]] size_t capacity() const { return m_used.size(); }
+        [[nodiscard]] size_t slotOf(std::span<const Value> arguments) const;
+        void grow();
+};
+
+// Owns the tables of every memoized function behind --memo, keeps what they hold alive, and
+// reports how well each one did. Engines hold a null Memoizer* when memoization is off.
+class Memoizer final : public GcRoots {
+    public:
+        Memoizer() { heap().addRoots(this); }
+        ~Memoizer() { heap().removeRoots(this); }
+        Memoizer(const Memoizer&) = delete;
+        Memoizer& operator=(const Memoizer&) = delete;
+
+        // The table for the function identified by `key` (its declaration), made on first use.
+        // `deps` are the globals its results depend on (Function_Stmt::m_memo_deps).
+        MemoTable& table(const void* key, std::string_view name, size_t line, size_t arity,
+                         std::span<const ObjString* const> deps);
+        // Called by the engines when a global that held a callable is redefined or assigned:
+        // retires the table of every function that depends on it.
+        void rebound(const ObjString* name);
+
+        void markRoots(Heap& heap) override;
+        void report(std::ostream& out) const;
+
+    private:
+        std::unordered_map<const void*, std::unique_ptr<MemoTable>> m_tables;
+        std::vector<const MemoTable*> m_order;
+        std::unordered_map<const ObjString*, std::vector<MemoTable*>, ObjStringHash> m_dependents;
+};
+
+#endif //MEMO_HPP
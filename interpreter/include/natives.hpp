@@ -0,0 +1,49 @@
+
+#ifndef NATIVES_HPP
+#define NATIVES_HPP
+
+#pragma once
+
+#include "callable.hpp"
+
+#include <span>
+#include <vector>
+
+// A builtin implemented in C++. Both engines call m_function directly with the argument
+// values; the tree-walker through LoxCallable::call, the VM straight from its stack.
+class NativeFunction final : public LoxCallable {
+    public:
+        using Function = Value (*)(std::span<const Value> arguments);
+
+        const ObjString* m_name;
+        const size_t m_arity;
+        const Function m_function;
+
+        NativeFunction(const ObjString* name, const size_t arity, const Function function)
+            : m_name(name), m_arity(arity), m_function(function) {}
+
+        [[nodiscard]] size_t arity() const override { return m_arity; }
+        Value call(Interpreter&, const std::span<const Value> arguments) override { return m_function(arguments); }
+        [[nodiscard]] size_t byteSize() const override { return sizeof(NativeFunction); }
+};
+
+// `object[index]`: an array element, which must exist, or a map entry, nil when missing.
+Value getIndex(const Value& object, const Value& index);
+// `object[index] = value`. Storing a new string key in a map may allocate, so all three values
+// must be reachable by the collector.
+void setIndex(const Value& object, const Value& index, const Value& value);
+
+// The builtins each engine defines as globals at startup; pinned, so never collected.
+//   Array(n)        a new array of n zeros
+//   len(x)          length of an array or string
+//   sum(a), min(a), max(a), dot(a, b)
+//   scale(a, k), add(a, b), prefixSum(a)   each returns a new array
+//   Map()           a new empty map
+//   get(m, k)       the value under k, or nil; set(m, k, v) stores and returns v
+//   has(m, k), delete(m, k)                 whether k is (was) present
+//   size(m)         the number of entries
+//   keyAt(m, i), valueAt(m, i)              entry i, 0 <= i < size(m), for iteration; deleting
+//                                           moves the last entry into the deleted one's place
+const std::vector<NativeFunction*>& natives();
+
+#endif //NATIVES_HPP
@@ -0,0 +1,254 @@
+
+#ifndef OBJECT_HPP
+#define OBJECT_HPP
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+class Heap;
+class Value;
+
+enum class ObjType : uint8_t {
+    STRING,
+    CONCAT,
+    ARRAY,
+    MAP,
+    CALLABLE,
+    ENVIRONMENT,
+    UPVALUE,
+};
+
+// Base of every heap-allocated runtime value. Values refer to objects by raw pointer;
+// the Heap owns them through the intrusive m_next list and frees whatever a collection
+// can't reach.
+class Obj {
+    public:
+        ObjType m_type;
+        bool m_marked = false;
+        // Never collected; used for strings the AST refers to (see Heap::constant).
+        bool m_pinned = false;
+        Obj* m_next = nullptr;
+
+        explicit Obj(const ObjType type) : m_type(type) {}
+        Obj(const Obj&) = delete;
+        Obj& operator=(const Obj&) = delete;
+        virtual ~Obj() = default;
+
+        // Marks every object this one refers to.
+        virtual void trace(Heap&) {}
+        // Approximate bytes owned by this object, for the collection trigger. An object whose
+        // size changes while alive must report it through Heap::resized().
+        [[nodiscard]] virtual size_t byteSize() const = 0;
+};
+
+// Immutable and interned: Heap::string() hands out exactly one ObjString per distinct
+// contents, so two strings are equal iff they are the same object.
+class ObjString final : public Obj {
+    private:
+        friend class Heap;
+
+        ObjString(std::string chars, const size_t hash)
+            : Obj(ObjType::STRING), m_chars(std::move(chars)), m_hash(hash) {}
+
+    public:
+        const std::string m_chars;
+        const size_t m_hash;
+
+        // FNV-1a, computed once when the string is interned.
+        static size_t hash(const std::string_view chars) {
+            uint64_t hash = 14695981039346656037ull;
+            for (const char c : chars) {
+                hash ^= static_cast<uint8_t>(c);
+                hash *= 1099511628211ull;
+            }
+            return static_cast<size_t>(hash);
+        }
+
+        [[nodiscard]] size_t byteSize() const override { return sizeof(ObjString) + m_chars.capacity(); }
+};
+
+// A string built at runtime by `+`, left uninterned so that growing a string in a loop is not
+// quadratic. It is a prefix of a buffer shared with the strings appended onto it: appending to
+// the string that ends at the buffer's end extends the buffer in place, and every earlier
+// string still sees its own unchanged prefix. Equal contents no longer imply the same object,
+// so Value equality compares characters when either side is a concatenation.
+class ObjConcat final : public Obj {
+    public:
+        const std::shared_ptr<std::string> m_buffer;
+        const size_t m_length;
+        // Bytes this string appended to the buffer, which is what it is charged for.
+        const size_t m_appended;
+
+        ObjConcat(std::shared_ptr<std::string> buffer, const size_t length, const size_t appended)
+            : Obj(ObjType::CONCAT), m_buffer(std::move(buffer)), m_length(length), m_appended(appended) {}
+
+        [[nodiscard]] std::string_view chars() const { return {m_buffer->data(), m_length}; }
+        [[nodiscard]] size_t byteSize() const override { return sizeof(ObjConcat) + m_appended; }
+};
+
+// A fixed-length array of numbers, stored contiguously so the builtins can run SIMD kernels
+// over it (see natives.hpp). Its length never changes, which keeps byteSize() stable.
+class ObjArray final : public Obj {
+    public:
+        std::vector<double> m_values;
+
+        explicit ObjArray(const size_t length) : Obj(ObjType::ARRAY), m_values(length) {}
+
+        [[nodiscard]] size_t byteSize() const override { return sizeof(ObjArray) + m_values.capacity() * sizeof(double); }
+};
+
+// Hasher for maps keyed by interned names; equality is plain pointer comparison.
+struct ObjStringHash {
+    size_t operator()(const ObjString* string) const { return string->m_hash; }
+};
+
+// Implemented by anything that holds Values the collector can't find by tracing from other
+// objects: the interpreter's environments and temporaries, the VM's stack and globals.
+class GcRoots {
+    public:
+        virtual void markRoots(Heap& heap) = 0;
+
+    protected:
+        ~GcRoots() = default;
+};
+
+// Mark-and-sweep collector. A collection runs before an allocation once the live heap has
+// grown by m_growth_factor since the last one, or on every allocation in stress mode.
+class Heap {
+    private:
+        struct InternHash {
+            using is_transparent = void;
+            size_t operator()(const ObjString* string) const { return string->m_hash; }
+            size_t operator()(const std::string_view chars) const { return ObjString::hash(chars); }
+        };
+        struct InternEqual {
+            using is_transparent = void;
+            static std::string_view chars(const ObjString* string) { return string->m_chars; }
+            static std::string_view chars(const std::string_view chars) { return chars; }
+            bool operator()(const auto& lhs, const auto& rhs) const { return chars(lhs) == chars(rhs); }
+        };
+
+        static constexpr size_t INITIAL_THRESHOLD = 1024 * 1024;
+
+        Obj* m_objects = nullptr;
+        // Weak: strings only reachable from here are freed by a collection.
+        std::unordered_set<ObjString*, InternHash, InternEqual> m_strings;
+        std::vector<GcRoots*> m_roots;
+        std::vector<Obj*> m_gray;
+
+        size_t m_bytes_allocated = 0;
+        size_t m_next_gc = INITIAL_THRESHOLD;
+        double m_growth_factor = 2.0;
+        bool m_stress = false;
+        size_t m_collections = 0;
+        // Strings constant() pinned for the first time while recording; see unpinRecorded().
+        bool m_recording = false;
+        std::vector<ObjString*> m_recorded;
+
+        template<typename Chars>
+        ObjString* intern(Chars&& chars) {
+            const std::string_view view = chars;
+            if (const auto it = m_strings.find(view); it != m_strings.end()) { return *it; }
+            const size_t hash = ObjString::hash(view);
+            ObjString* string = make<ObjString>(std::string(std::forward<Chars>(chars)), hash);
+            m_strings.insert(string);
+            return string;
+        }
+
+        void sweep();
+
+    public:
+        Heap() = default;
+        Heap(const Heap&) = delete;
+        Heap& operator=(const Heap&) = delete;
+
+        ~Heap() {
+            while (m_objects) {
+                Obj* next = m_objects->m_next;
+                delete m_objects;
+                m_objects = next;
+            }
+        }
+
+        template<typename T, typename ... Args>
+        T* make(Args&& ... args) {
+            // Collect first: the new object isn't reachable from any root yet.
+            if (m_stress || m_bytes_allocated > m_next_gc) { collect(); }
+            T* object = new T(std::forward<Args>(args)...);
+            object->m_next = m_objects;
+            m_objects = object;
+            m_bytes_allocated += object->byteSize();
+            return object;
+        }
+
+        // Returns the canonical string with these contents, creating it on first use.
+        ObjString* string(const std::string_view chars) { return intern(chars); }
+        ObjString* string(std::string&& chars) { return intern(std::move(chars)); }
+
+        // `left + right` for two string values. Short results are interned; longer ones become
+        // an ObjConcat, appended in place when `left` ends its buffer. The operands are read
+        // before anything is allocated, so they need not be rooted.
+        Obj* concat(const Value& left, const Value& right);
+        // `chars * times`: the string repeated ceil(times) times (none if times <= 0).
+        ObjString* repeat(std::string_view chars, double times);
+
+        // Like string(), but the result is never collected. The scanner uses this for literals
+        // and identifiers, which the AST (and bytecode compiled from it) refers to directly.
+        ObjString* constant(const std::string_view chars) {
+            ObjString* string = intern(chars);
+            if (m_recording && !string->m_pinned) { m_recorded.push_back(string); }
+            string->m_pinned = true;
+            return string;
+        }
+
+        // --stream discards the AST of most statements once they ran, and with it the reason to
+        // pin their constants. While recording, constant() lists the strings it pins for the
+        // first time; unpinRecorded() lets a collection free those again unless something at
+        // runtime still reaches them, and forgetRecorded() leaves them pinned for good.
+        void setRecording(const bool recording) { m_recording = recording; }
+        void unpinRecorded() {
+            for (ObjString* string : m_recorded) { string->m_pinned = false; }
+            m_recorded.clear();
+        }
+        void forgetRecorded() { m_recorded.clear(); }
+
+        // Accounts for a live object that grew or shrank from `before` to `after` bytes.
+        void resized(const size_t before, const size_t after) { m_bytes_allocated = m_bytes_allocated - before + after; }
+
+        void addRoots(GcRoots* roots) { m_roots.push_back(roots); }
+        void removeRoots(GcRoots* roots) { std::erase(m_roots, roots); }
+
+        void mark(Obj* object) {
+            if (!object || object->m_marked) { return; }
+            object->m_marked = true;
+            m_gray.push_back(object);
+        }
+        void mark(const Value& value);
+
+        // Runs a full collection now.
+        void collect();
+
+        // The next collection triggers once the live heap has grown by this factor.
+        void setGrowthFactor(const double factor) { m_growth_factor = std::max(factor, 1.0); }
+        // Collect before every allocation, to shake out missing roots.
+        void setStress(const bool stress) { m_stress = stress; }
+
+        [[nodiscard]] size_t bytesAllocated() const { return m_bytes_allocated; }
+        [[nodiscard]] size_t collections() const { return m_collections; }
+};
+
+// The process-wide heap shared by the scanner, both engines and their callables.
+inline Heap& heap() {
+    static Heap instance;
+    return instance;
+}
+
+#endif //OBJECT_HPP
@@ -0,0 +1,83 @@
+#ifndef OPERATORS_HPP
+#define OPERATORS_HPP
+
+#pragma once
+
+#include "token.hpp"
+#include "value.hpp"
+
+#include <functional>
+
+// The binary operators of the tree-walker and the closure engine, and the errors they raise.
+// Two numbers are handled inline; they are never nil, so the nil check every other pair of
+// operands gets comes after, in the out-of-line rest. The tree-walker's quickened sites and
+// the closure engine's compiled nodes call these directly, generic sites through
+// binaryOperator().
+
+Value addOperands(Value left, Value right);
+Value subtractOperands(Value left, Value right);
+Value multiplyOperands(Value left, Value right);
+Value divideOperands(Value left, Value right);
+Value compareOperands(TokenType type, Value left, Value right);
+Value equalOperands(Value left, Value right, bool equal);
+
+inline Value binaryAdd(const Value left, const Value right) {
+    if (left.isNumber() && right.isNumber()) { return Value::number(left.asNumber() + right.asNumber()); }
+    return addOperands(left, right);
+}
+
+inline Value binarySubtract(const Value left, const Value right) {
+    if (left.isNumber() && right.isNumber()) { return Value::number(left.asNumber() - right.asNumber()); }
+    return subtractOperands(left, right);
+}
+
+inline Value binaryMultiply(const Value left, const Value right) {
+    if (left.isNumber() && right.isNumber()) { return Value::number(left.asNumber() * right.asNumber()); }
+    return multiplyOperands(left, right);
+}
+
+inline Value binaryDivide(const Value left, const Value right) {
+    if (left.isNumber() && right.isNumber() && right.asNumber() != 0.0) {
+        return Value::number(left.asNumber() / right.asNumber());
+    }
+    return divideOperands(left, right);
+}
+
+// `type` is the operator Compare implements (LESS for std::less<> and so on).
+template<typename Compare, TokenType type>
+Value binaryCompare(const Value left, const Value right) {
+    if (left.isNumber() && right.isNumber()) { return Value::boolean(Compare{}(left.asNumber(), right.asNumber())); }
+    return compareOperands(type, left, right);
+}
+
+inline Value binaryLess(const Value left, const Value right) {
+    return binaryCompare<std::less<>, TokenType::LESS>(left, right);
+}
+
+inline Value binaryLessEqual(const Value left, const Value right) {
+    return binaryCompare<std::less_equal<>, TokenType::LESS_EQUAL>(left, right);
+}
+
+inline Value binaryGreater(const Value left, const Value right) {
+    return binaryCompare<std::greater<>, TokenType::GREATER>(left, right);
+}
+
+inline Value binaryGreaterEqual(const Value left, const Value right) {
+    return binaryCompare<std::greater_equal<>, TokenType::GREATER_EQUAL>(left, right);
+}
+
+inline Value binaryEqual(const Value left, const Value right) {
+    if (left.isNumber() && right.isNumber()) { return Value::boolean(left.asNumber() == right.asNumber()); }
+    return equalOperands(left, right, true);
+}
+
+inline Value binaryNotEqual(const Value left, const Value right) {
+    if (left.isNumber() && right.isNumber()) { return Value::boolean(left.asNumber() != right.asNumber()); }
+    return equalOperands(left, right, false);
+}
+
+// The operator for `type`, or null if it isn't a binary operator.
+using BinaryOperator = Value (*)(Value left, Value right);
+BinaryOperator binaryOperator(TokenType type);
+
+#endif //OPERATORS_HPP
@@ -0,0 +1,100 @@
+
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#pragma once
+
+#include "arena.hpp"
+#include "expr.hpp"
+#include "statement.hpp"
+
+#include <memory>
+#include <vector>
+
+// One rewrite over a parsed program. The traversal is post-order: every node is offered to
+// simplify() after its children were rewritten, and nodes whose children changed are rebuilt
+// in the Program's arena (the originals are left untouched). The Resolver runs once before the
+// passes, so errors in code they delete are still reported, and again afterwards to annotate
+// the rewritten tree; passes never have to preserve its annotations.
+class Pass : public Expr_Visitor, public Stmt_Visitor {
+    public:
+        ~Pass() override = default;
+        void run(std::vector<Stmt*>& statements, Arena& arena);
+
+        void visitBinaryExpr(const Binary_Expr &expr) override;
+        void visitGroupingExpr(const Grouping_Expr &expr) override;
+        void visitLiteralExpr(const Literal_Expr &expr) override;
+        void visitUnaryExpr(const Unary_Expr &expr) override;
+        void visitVariableExpr(const Variable_Expr &expr) override;
+        void visitAssignExpr(const Assign_Expr &expr) override;
+        void visitCallExpr(const Call_Expr &expr) override;
+        void visitArrayExpr(const Array_Expr &expr) override;
+        void visitIndexExpr(const Index_Expr &expr) override;
+        void visitIndexSetExpr(const IndexSet_Expr &expr) override;
+
+        void visitExpressionStmt(const Expression_Stmt &stmt) override;
+        void visitPrintStmt(const Print_Stmt &stmt) override;
+        void visitVarStmt(const Var_Stmt &stmt) override;
+        void visitBlockStmt(const Block_Stmt &stmt) override;
+        void visitIfStmt(const If_Stmt &stmt) override;
+        void visitWhileStmt(const While_Stmt &stmt) override;
+        void visitForStmt(const For_Stmt &stmt) override;
+        void visitFunctionStmt(const Function_Stmt &stmt) override;
+        void visitReturnStmt(const Return_Stmt &stmt) override;
+        void visitBreakStmt(const Break_Stmt &stmt) override;
+        void visitContinueStmt(const Continue_Stmt &stmt) override;
+
+    protected:
+        Arena* m_arena = nullptr;
+
+        // Returns the replacement for a node; a null statement is removed.
+        virtual Expr* simplify(Expr* expr) { return expr; }
+        virtual Stmt* simplify(Stmt* stmt) { return stmt; }
+
+    private:
+        // The node being visited, returned as-is when none of its children changed.
+        Expr* m_expr = nullptr;
+        Stmt* m_stmt = nullptr;
+
+        Expr* rewrite(Expr* expr);
+        Stmt* rewrite(Stmt* stmt);
+        // For a statement that must stay present (a loop or branch body).
+        Stmt* rewriteBody(Stmt* stmt);
+        StmtList rewrite(StmtList statements);
+        ExprList rewrite(ExprList exprs);
+};
+
+// Folds operators whose operands are literals, and groupings of a literal. Anything that would
+// raise a runtime error (nil operands, mismatched types, division by zero) is left alone so
+// the error still happens when, and if, the expression runs.
+class ConstantFolding final : public Pass {
+    protected:
+        Expr* simplify(Expr* expr) override;
+};
+
+// Replaces an `if` on a literal condition with the branch taken and drops `while` loops whose
+// literal condition is falsey.
+class DeadBranchElimination final : public Pass {
+    protected:
+        Stmt* simplify(Stmt* stmt) override;
+};
+
+// Identities that hold for every double: e * 1, 1 * e, e / 1, e - 0 and -(-e) become e. They
+// are only applied when e is known to produce a number or fail; e.g. "ab" * 1 is a repeat.
+class AlgebraicSimplification final : public Pass {
+    protected:
+        Expr* simplify(Expr* expr) override;
+};
+
+// Runs the passes selected by an optimization level: -O0 none, -O1 constant folding and
+// dead-branch elimination, -O2 adds algebraic simplification.
+class Optimizer {
+    public:
+        explicit Optimizer(int level);
+        void optimize(std::vector<Stmt*>& statements, Arena& arena) const;
+
+    private:
+        std::vector<std::unique_ptr<Pass>> m_passes;
+};
+
+#endif //OPTIMIZER_HPP
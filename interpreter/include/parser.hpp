@@ -4,55 +4,83 @@
 
 #pragma once
 
+#include "arena.hpp"
+#include "scanner.hpp"
 #include "token.hpp"
 #include "expr.hpp"
 #include "statement.hpp"
 
+#include <array>
+#include <string_view>
+#include <vector>
+
 class Parser {
     private:
-        std::vector<Token> m_tokens;
+        // Lookahead ring: the current token is at m_pos and the one before it at m_pos - 1 (both
+        // modulo the ring size); advance() scans the next token into the slot it moves onto.
+        static constexpr size_t LOOKAHEAD = 4;
+        // The bytecode's CALL operand and a VmFunction's arity are a byte.
+        static constexpr size_t MAX_ARGUMENTS = 255;
+        Scanner& m_scanner;
+        std::string_view m_source;
+        std::array<Token, LOOKAHEAD> m_ring {};
         size_t m_pos {};
+        size_t m_functions {};
+        bool m_had_error {};
+        Arena& m_arena;
 
-        std::shared_ptr<Stmt> declaration();
-        std::shared_ptr<Stmt> statement();
-        std::shared_ptr<Stmt> print_statement();
-        std::shared_ptr<Stmt> expression_statement();
-        std::shared_ptr<Stmt> var_declaration();
-        std::shared_ptr<Stmt> if_statement();
-        std::shared_ptr<Stmt> while_statement();
-        std::shared_ptr<Stmt> for_statement();
-        std::shared_ptr<Stmt> function_declaration();
-        std::vector<std::shared_ptr<Stmt>> block_statement();
-        std::shared_ptr<Stmt> return_statement();
+        Stmt* declaration();
+        Stmt* statement();
+        Stmt* print_statement();
+        Stmt* expression_statement();
+        Stmt* var_declaration();
+        Stmt* if_statement();
+        Stmt* while_statement();
+        Stmt* for_statement();
+        Stmt* function_declaration();
+        StmtList block_statement();
+        Stmt* return_statement();
+        Stmt* jump_statement();
 
     void synchronize();
 
-        std::shared_ptr<Expr> expression();
-        std::shared_ptr<Expr> assignment();
-        std::shared_ptr<Expr> equality();
-        std::shared_ptr<Expr> comparison();
-        std::shared_ptr<Expr> term();
-        std::shared_ptr<Expr> factor();
-        std::shared_ptr<Expr> unary();
-        std::shared_ptr<Expr> primary();
-        std::shared_ptr<Expr> call();
-        std::shared_ptr<Expr> finish_call(std::shared_ptr<Expr> callee);
+        Expr* expression();
+        Expr* assignment();
+        Expr* equality();
+        Expr* comparison();
+        Expr* term();
+        Expr* factor();
+        Expr* unary();
+        Expr* primary();
+        Expr* call();
+        Expr* finish_call(Expr* callee);
 
         template<typename ... Types>
         bool match(Types ...types);
 
         [[nodiscard]] bool check(const TokenType& type) const;
         const Token& advance();
-        [[nodiscard]] bool is_at_end() const;
         const Token& peek() const;
         const Token& previous() const;
         const Token& consume(TokenType type, const std::string& message);
+        // Interns an identifier token's lexeme; the AST keeps names, not tokens.
+        [[nodiscard]] Identifier identifier(const Token& token) const;
 
 
     public:
-        explicit Parser(std::vector<Token>&& tokens)
-            :m_tokens(std::move(tokens)) {}
-        std::vector<std::shared_ptr<Stmt>> parse();
+        // Nodes are allocated in `arena`, normally the one owned by the Program being parsed.
+        // Tokens are pulled from `scanner` as parsing reaches them.
+        Parser(Scanner& scanner, Arena& arena);
+        std::vector<Stmt*> parse();
+
+        // Parses one top-level declaration, for callers that run statements as they arrive.
+        // Returns null after a syntax error, which has already been reported.
+        Stmt* next_declaration() { return declaration(); }
+        [[nodiscard]] bool is_at_end() const;
+        // Function declarations parsed so far, at any depth.
+        [[nodiscard]] size_t functions_parsed() const { return m_functions; }
+        // Whether a syntax error was reported; the program is not to be run then.
+        [[nodiscard]] bool had_error() const { return m_had_error; }
 };
 
 #endif //PARSER_HPP
@@ -0,0 +1,94 @@
+
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Function-level profiler behind --profile. Both engines report every Lox call through
+// enter()/exit(); the profiler keeps call counts, self and inclusive time per function and
+// per call-site line, plus a call tree that is written out as folded stacks for flame graphs.
+// Engines hold a null Profiler* when profiling is off, so the only cost then is that check.
+class Profiler {
+    public:
+        Profiler();
+
+        // Identifies a function by a stable key (its declaration) and returns the id to enter it with.
+        size_t function(const void* key, std::string_view name, size_t line);
+
+        void enter(size_t function_id, size_t call_line);
+        void exit();
+        // A tail call: the running function's frame ends and `function_id`'s takes its place.
+        void replace(size_t function_id, size_t call_line);
+
+        // Number of active frames, including the script's own. unwind() exits frames until only
+        // `depth` remain, for when a runtime error abandons calls in progress.
+        [[nodiscard]] size_t depth() const { return m_stack.size(); }
+        void unwind(size_t depth);
+
+        // Stops the clock on the script frame; call once execution is over.
+        void finish();
+
+        void report(std::ostream& out) const;
+        void writeFolded(std::ostream& out) const;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct FunctionStats {
+            std::string name;
+            size_t line;
+            uint64_t calls = 0;
+            int64_t self_ns = 0;
+            int64_t inclusive_ns = 0;
+            // Activations currently on the stack, so recursion counts inclusive time once.
+            size_t active = 0;
+
+            FunctionStats(std::string name, const size_t line) : name(std::move(name)), line(line) {}
+        };
+
+        struct LineStats {
+            uint64_t calls = 0;
+            int64_t inclusive_ns = 0;
+            size_t active = 0;
+        };
+
+        // A node in the call tree; its path from the root is one folded stack.
+        struct Node {
+            size_t function_id;
+            size_t parent;
+            int64_t self_ns = 0;
+            std::unordered_map<size_t, size_t> children;
+
+            Node(const size_t function_id, const size_t parent) : function_id(function_id), parent(parent) {}
+        };
+
+        struct Frame {
+            size_t node;
+            size_t call_line;
+            Clock::time_point start;
+            int64_t children_ns = 0;
+
+            Frame(const size_t node, const size_t call_line, const Clock::time_point start)
+                : node(node), call_line(call_line), start(start) {}
+        };
+
+        std::unordered_map<const void*, size_t> m_ids;
+        std::vector<FunctionStats> m_functions;
+        std::map<size_t, LineStats> m_lines;
+        std::vector<Node> m_nodes;
+        std::vector<Frame> m_stack;
+
+        [[nodiscard]] std::string stackOf(size_t node) const;
+};
+
+#endif //PROFILER_HPP
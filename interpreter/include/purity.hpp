@@ -0,0 +1,81 @@
+
+#ifndef PURITY_HPP
+#define PURITY_HPP
+
+#pragma once
+
+#include "expr.hpp"
+#include "statement.hpp"
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Finds the global functions whose result depends only on their arguments, so --memo can
+// cache it, and sets Function_Stmt::m_pure on them. Runs after the Resolver, on the statements
+// prepared together. A pure function:
+//   - reads and assigns only its parameters and its own locals,
+//   - doesn't print, build arrays, assign through an index or declare nested functions,
+//   - calls only pure functions, by the name of a global function declared once among the
+//     statements and never assigned or redeclared by them.
+// Statements prepared later may still rebind those globals, so each pure function also gets
+// the names it calls, directly or not, in Function_Stmt::m_memo_deps; the Memoizer stops
+// caching it when one of them is rebound.
+class PurityAnalysis final : public Expr_Visitor, public Stmt_Visitor {
+    public:
+        explicit PurityAnalysis(Arena& arena) : m_arena(arena) {}
+
+        void analyze(StmtList statements);
+
+        void visitBinaryExpr(const Binary_Expr &expr) override;
+        void visitGroupingExpr(const Grouping_Expr &expr) override;
+        void visitLiteralExpr(const Literal_Expr &expr) override;
+        void visitUnaryExpr(const Unary_Expr &expr) override;
+        void visitVariableExpr(const Variable_Expr &expr) override;
+        void visitAssignExpr(const Assign_Expr &expr) override;
+        void visitCallExpr(const Call_Expr &expr) override;
+        void visitArrayExpr(const Array_Expr &expr) override;
+        void visitIndexExpr(const Index_Expr &expr) override;
+        void visitIndexSetExpr(const IndexSet_Expr &expr) override;
+
+        void visitExpressionStmt(const Expression_Stmt &stmt) override;
+        void visitPrintStmt(const Print_Stmt &stmt) override;
+        void visitVarStmt(const Var_Stmt &stmt) override;
+        void visitBlockStmt(const Block_Stmt &stmt) override;
+        void visitIfStmt(const If_Stmt &stmt) override;
+        void visitWhileStmt(const While_Stmt &stmt) override;
+        void visitForStmt(const For_Stmt &stmt) override;
+        void visitFunctionStmt(const Function_Stmt &stmt) override;
+        void visitReturnStmt(const Return_Stmt &stmt) override;
+        void visitBreakStmt(const Break_Stmt &stmt) override;
+        void visitContinueStmt(const Continue_Stmt &stmt) override;
+
+    private:
+        Arena& m_arena;
+
+        struct Candidate {
+            const Function_Stmt* stmt;
+            bool pure = true;
+            std::vector<const ObjString*> calls;
+        };
+
+        std::unordered_map<const ObjString*, Candidate, ObjStringHash> m_candidates;
+        // Globals the statements assign or declare more than once.
+        std::unordered_set<const ObjString*, ObjStringHash> m_unstable;
+        std::unordered_set<const ObjString*, ObjStringHash> m_declared;
+        // The global function being checked.
+        Candidate* m_current = nullptr;
+
+        void visit(const Expr* expr);
+        void visit(Stmt* stmt);
+        void visit(StmtList statements);
+        void declareGlobal(const ObjString* name);
+        [[nodiscard]] std::vector<const ObjString*> dependencies(const Candidate& candidate) const;
+        // Called for each write: to a local of the function being checked, or to a global.
+        void write(const ObjString* name, int depth);
+        // Whether a variable is in the running frame, which inside a candidate is its own.
+        static bool isLocal(const int depth) { return depth == 0; }
+        void impure() { if (m_current) { m_current->pure = false; } }
+};
+
+#endif //PURITY_HPP
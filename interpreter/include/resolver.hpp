@@ -0,0 +1,94 @@
+
+#ifndef RESOLVER_HPP
+#define RESOLVER_HPP
+
+#pragma once
+
+#include "arena.hpp"
+#include "expr.hpp"
+#include "statement.hpp"
+
+#include <unordered_map>
+#include <vector>
+
+// Static pass run between Parser::parse() and Interpreter::interpret(). It mirrors the
+// scopes the interpreter creates at runtime (blocks, for-loops and calls) and annotates every
+// variable reference with a (depth, slot) pair, see Variable_Expr. Locals live in the frame of
+// the call that declares them, or of the script outside any function: each gets a slot there,
+// and sibling blocks share slots. Anything not found in an enclosing scope is a global. A
+// variable of a scope outside the current function is captured, becoming one of the function's
+// upvalues, listed in Function_Stmt::m_captures (allocated from `arena`); a function inside
+// another captures through the one around it. Scopes with captured variables are flagged in
+// their ScopeSlots. It also rejects return outside a function and break/continue outside a loop.
+class Resolver : public Expr_Visitor, public Stmt_Visitor {
+    public:
+        explicit Resolver(Arena& arena) : m_arena(arena) {}
+        void resolve(StmtList statements);
+
+        void visitBinaryExpr(const Binary_Expr &expr) override;
+        void visitGroupingExpr(const Grouping_Expr &expr) override;
+        void visitLiteralExpr(const Literal_Expr &expr) override;
+        void visitUnaryExpr(const Unary_Expr &expr) override;
+        void visitVariableExpr(const Variable_Expr &expr) override;
+        void visitAssignExpr(const Assign_Expr &expr) override;
+        void visitCallExpr(const Call_Expr &expr) override;
+        void visitArrayExpr(const Array_Expr &expr) override;
+        void visitIndexExpr(const Index_Expr &expr) override;
+        void visitIndexSetExpr(const IndexSet_Expr &expr) override;
+
+        void visitExpressionStmt(const Expression_Stmt &stmt) override;
+        void visitPrintStmt(const Print_Stmt &stmt) override;
+        void visitVarStmt(const Var_Stmt &stmt) override;
+        void visitBlockStmt(const Block_Stmt &stmt) override;
+        void visitIfStmt(const If_Stmt &stmt) override;
+        void visitWhileStmt(const While_Stmt &stmt) override;
+        void visitForStmt(const For_Stmt &stmt) override;
+        void visitFunctionStmt(const Function_Stmt &stmt) override;
+        void visitReturnStmt(const Return_Stmt &stmt) override;
+        void visitBreakStmt(const Break_Stmt &stmt) override;
+        void visitContinueStmt(const Continue_Stmt &stmt) override;
+
+    private:
+        struct Scope {
+            std::unordered_map<const ObjString*, size_t, ObjStringHash> slots;
+            // The frame slots it and the scopes inside it took so far.
+            ScopeSlots range;
+        };
+
+        // Slot allocation in one frame: the next free slot, and the most in use at once.
+        struct Frame {
+            size_t next = 0;
+            size_t size = 0;
+        };
+
+        // A function being resolved: the index of its scope in m_scopes, its frame, and what
+        // it captures, mapped to the upvalue index.
+        struct Function {
+            size_t scope;
+            Frame frame;
+            std::unordered_map<const ObjString*, size_t, ObjStringHash> captured;
+            std::vector<Capture> captures;
+        };
+
+        Arena& m_arena;
+        std::vector<Scope> m_scopes;
+        // Enclosing functions and loops, also for rejecting misplaced return/break/continue.
+        std::vector<Function> m_functions;
+        // The frame of blocks outside any function.
+        Frame m_script;
+        size_t m_loop_depth = 0;
+
+        Frame& frame() { return m_functions.empty() ? m_script : m_functions.back().frame; }
+
+        void resolve(Stmt* stmt);
+        void resolve(const Expr* expr);
+        void beginScope();
+        ScopeSlots endScope();
+        int declare(const ObjString* name);
+        void resolveName(const ObjString* name, int& depth, size_t& slot);
+        size_t capture(size_t function, size_t scope, size_t slot, const ObjString* name);
+        void resolveLoopBody(Stmt* body);
+        void checkInLoop(const Token& keyword) const;
+};
+
+#endif //RESOLVER_HPP
@@ -0,0 +1,24 @@
+
+#ifndef SCAN_KERNELS_HPP
+#define SCAN_KERNELS_HPP
+
+#pragma once
+
+#include <cstddef>
+
+// Bulk scanning loops for the Scanner's long runs: comments, string literals and whitespace.
+// Each takes [begin, end), adds the newlines it passes over to `lines`, and returns where it
+// stopped (end if nothing matched). The implementation is picked once at startup: AVX2 or
+// SSE2 on x86-64 (32 or 16 bytes per step), otherwise a scalar loop.
+struct ScanKernels {
+    // The first occurrence of `target`.
+    const char* (*find)(const char* begin, const char* end, char target, size_t& lines);
+    // The first byte that isn't a space, tab, carriage return or newline.
+    const char* (*skipWhitespace)(const char* begin, const char* end, size_t& lines);
+    // "avx2", "sse2" or "scalar".
+    const char* name;
+};
+
+const ScanKernels& scanKernels();
+
+#endif //SCAN_KERNELS_HPP
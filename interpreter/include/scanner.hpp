@@ -4,45 +4,37 @@
 
 #pragma once
 
+#include "scan_kernels.hpp"
 #include "token.hpp"
-#include <map>
-
-static std::unordered_map<std::string, TokenType> keywords = {
-    {"and", TokenType::AND},
-    {"class", TokenType::CLASS},
-    {"else", TokenType::ELSE},
-    {"false", TokenType::FALSE},
-    {"for", TokenType::FOR},
-    {"fun", TokenType::FUN},
-    {"if", TokenType::IF},
-    {"nil", TokenType::NIL},
-    {"or", TokenType::OR},
-    {"print", TokenType::PRINT},
-    {"return", TokenType::RETURN},
-    {"super", TokenType::SUPER},
-    {"this", TokenType::THIS},
-    {"true", TokenType::TRUE},
-    {"var", TokenType::VAR},
-    {"while", TokenType::WHILE},
-};
+#include <optional>
+#include <string_view>
 
 class Scanner {
     private:
-        std::string m_src;
-        std::vector<Token> m_tokens;
+        std::string_view m_src;
+        // The token scanToken() produced, if any; whitespace and comments produce none.
+        std::optional<Token> m_token;
         size_t m_start = 0, m_current = 0, m_line = 1;
+        const ScanKernels& m_kernels = scanKernels();
 
     public:
-        Scanner(std::string&& src) : m_src(std::move(src)) {}
-        std::vector<Token> scan();
+        // Tokens are offsets into `src`, so it must outlive them (see Program).
+        explicit Scanner(std::string_view src);
+        // Scans and returns the next token; EndOfFile once the source is exhausted, and from
+        // then on. The parser pulls tokens one at a time, so no token array is ever built.
+        Token next();
+        [[nodiscard]] std::string_view source() const { return m_src; }
         [[nodiscard]] bool isAtEnd() const;
         void scanToken();
         char advance();
         [[nodiscard]] char peek() const;
         [[nodiscard]] char peekNext() const;
         bool match(char expected);
-        void addNullToken(const TokenType& type);
-        void addToken(const TokenType& type, const OptionalLiteral& literal);
+        void addToken(const TokenType& type);
+        // Bulk skips: m_current moves to the stop the kernel finds and m_line is updated.
+        void skipWhitespace();
+        void lineComment();
+        void blockComment();
         void string();
         void number();
         void identifier();
@@ -0,0 +1,37 @@
+
+#ifndef SOURCE_HPP
+#define SOURCE_HPP
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// The text of one script. Files are memory-mapped read-only, so scanning a large script does
+// not first copy it into a string; REPL lines and empty files are held in an owned string.
+// Tokens record offsets into text(), which therefore must not move while they are in use.
+class Source {
+    private:
+        std::string m_owned;
+        const char* m_mapped = nullptr;
+        size_t m_size = 0;
+
+        Source() = default;
+
+    public:
+        explicit Source(std::string text) : m_owned(std::move(text)) {}
+        // Throws std::runtime_error if the file can't be opened or mapped.
+        static Source map(const char* path);
+
+        Source(Source&& other) noexcept;
+        Source& operator=(Source&&) = delete;
+        Source(const Source&) = delete;
+        Source& operator=(const Source&) = delete;
+        ~Source();
+
+        [[nodiscard]] std::string_view text() const {
+            return m_mapped ? std::string_view(m_mapped, m_size) : std::string_view(m_owned);
+        }
+};
+
+#endif //SOURCE_HPP
@@ -1,9 +1,13 @@
 #ifndef STATEMENT_HPP
 #define STATEMENT_HPP
 
+#include "arena.hpp"
 #include "expr.hpp"
+#include "source.hpp"
 #include "token.hpp"
-#include <memory>
+#include <span>
+#include <string>
+#include <vector>
 
 class Expr;
 
@@ -16,6 +20,8 @@ class While_Stmt;
 class For_Stmt;
 class Function_Stmt;
 class Return_Stmt;
+class Break_Stmt;
+class Continue_Stmt;
 
 class Stmt_Visitor {
     public:
@@ -28,95 +34,159 @@ class Stmt_Visitor {
         virtual void visitForStmt(const For_Stmt& stmt) = 0;
         virtual void visitFunctionStmt(const Function_Stmt& stmt) = 0;
         virtual void visitReturnStmt(const Return_Stmt& stmt) = 0;
+        virtual void visitBreakStmt(const Break_Stmt& stmt) = 0;
+        virtual void visitContinueStmt(const Continue_Stmt& stmt) = 0;
         virtual ~Stmt_Visitor() = default;
 };
 
 class Stmt {
     public:
         virtual void accept(Stmt_Visitor& visitor) = 0;
-        virtual ~Stmt() = default;
+
+    protected:
+        ~Stmt() = default;
+};
+
+using StmtList = std::span<Stmt* const>;
+
+// The frame slots [begin, end) that a block or for-loop and the blocks inside it declare
+// variables in, set by the Resolver. `captured` when a function declared inside captures one
+// of them: leaving the scope then drops the boxes, so the next entry gets fresh variables.
+struct ScopeSlots {
+    uint32_t begin = 0;
+    uint32_t end = 0;
+    bool captured = false;
 };
 
 class Expression_Stmt : public Stmt {
     public:
-        std::shared_ptr<Expr> m_expression;
-        explicit Expression_Stmt(std::shared_ptr<Expr> expression);
+        Expr* m_expression;
+        explicit Expression_Stmt(Expr* expression);
         void accept(Stmt_Visitor& visitor) override;
 };
 
 class Print_Stmt : public Stmt {
     public:
-        std::shared_ptr<Expr> m_expression;
-        explicit Print_Stmt(std::shared_ptr<Expr> expression);
+        Expr* m_expression;
+        explicit Print_Stmt(Expr* expression);
         void accept(Stmt_Visitor& visitor) override;
 };
 
 class Var_Stmt : public Stmt {
     public:
-        Token m_name;
-        std::shared_ptr<Expr> m_value;
-        Var_Stmt(Token name, std::shared_ptr<Expr> value);
+        Identifier m_name;
+        Expr* m_value;
+        // Slot assigned by the Resolver, or -1 for a global.
+        mutable int m_slot = -1;
+        Var_Stmt(const Identifier& name, Expr* value);
         void accept(Stmt_Visitor& visitor) override;
 };
 
 class Block_Stmt : public Stmt {
     public:
-        std::vector<std::shared_ptr<Stmt>> m_statements;
-        explicit Block_Stmt(std::vector<std::shared_ptr<Stmt>> statements) : m_statements(std::move(statements)) {}
+        StmtList m_statements;
+        mutable ScopeSlots m_slots;
+        explicit Block_Stmt(const StmtList statements) : m_statements(statements) {}
         void accept(Stmt_Visitor& visitor) override { visitor.visitBlockStmt(*this); }
 };
 
 class If_Stmt : public Stmt {
     public:
-    std::shared_ptr<Expr> m_condition;
-    std::shared_ptr<Stmt> m_then_branch;
-    std::shared_ptr<Stmt> m_else_branch;
+    Expr* m_condition;
+    Stmt* m_then_branch;
+    Stmt* m_else_branch;
 
-    If_Stmt(std::shared_ptr<Expr> condition, std::shared_ptr<Stmt> then_branch, std::shared_ptr<Stmt> else_branch)
-        :m_condition(std::move(condition)), m_then_branch(std::move(then_branch)), m_else_branch(std::move(else_branch)) {}
+    If_Stmt(Expr* condition, Stmt* then_branch, Stmt* else_branch)
+        :m_condition(condition), m_then_branch(then_branch), m_else_branch(else_branch) {}
     void accept(Stmt_Visitor& visitor) override { visitor.visitIfStmt(*this); }
 };
 
 class While_Stmt : public Stmt {
     public:
-        std::shared_ptr<Expr> m_condition;
-        std::shared_ptr<Stmt> m_body;
+        Expr* m_condition;
+        Stmt* m_body;
 
-        While_Stmt(std::shared_ptr<Expr> condition, std::shared_ptr<Stmt> body)
-            :m_condition(std::move(condition)), m_body(std::move(body)) {}
+        While_Stmt(Expr* condition, Stmt* body)
+            :m_condition(condition), m_body(body) {}
         void accept(Stmt_Visitor& visitor) override { visitor.visitWhileStmt(*this); }
 };
 
 class For_Stmt : public Stmt {
     public:
-        std::shared_ptr<Stmt> m_initializer;
-        std::shared_ptr<Expr> m_condition;
-        std::shared_ptr<Expr> m_step;
-        std::shared_ptr<Stmt> m_body;
-
-        For_Stmt(std::shared_ptr<Stmt> initializer, std::shared_ptr<Expr> condition, std::shared_ptr<Expr> step, std::shared_ptr<Stmt> body)
-            :m_initializer(std::move(initializer)), m_condition(std::move(condition)), m_step(std::move(step)), m_body(std::move(body)) {}
+        Stmt* m_initializer;
+        Expr* m_condition;
+        Expr* m_step;
+        Stmt* m_body;
+        mutable ScopeSlots m_slots;
+
+        For_Stmt(Stmt* initializer, Expr* condition, Expr* step, Stmt* body)
+            :m_initializer(initializer), m_condition(condition), m_step(step), m_body(body) {}
         void accept(Stmt_Visitor& visitor) override { visitor.visitForStmt(*this); }
 };
 
+// A variable a function captures where it is declared: with a depth of 0 the variable in
+// `slot` of the frame running the declaration, with 1 that frame's function's upvalue `slot`.
+// Captures are the function's upvalues, in order.
+struct Capture {
+    uint32_t depth;
+    uint32_t slot;
+};
+
 class Function_Stmt : public Stmt {
     public:
-        Token m_name;
-        std::vector<Token> m_arguments;
-        std::vector<std::shared_ptr<Stmt>> m_statements;
-
-        Function_Stmt(Token name, std::vector<Token> arguments, std::vector<std::shared_ptr<Stmt>> statements)
-            :m_name(std::move(name)), m_arguments(std::move(arguments)), m_statements(std::move(statements)) {}
+        Identifier m_name;
+        std::span<const Identifier> m_arguments;
+        StmtList m_statements;
+        // m_slot is where the function itself is bound (-1 for a global); m_scope_size is the
+        // number of slots its call frame needs, parameters first. Set by the Resolver, like
+        // m_captures: the free variables the body refers to, globals aside.
+        mutable int m_slot = -1;
+        mutable size_t m_scope_size = 0;
+        mutable std::span<const Capture> m_captures;
+        // Set by PurityAnalysis under --memo, with the globals a pure function's result depends
+        // on: every function it calls, directly or through others.
+        mutable bool m_pure = false;
+        mutable std::span<const ObjString* const> m_memo_deps;
+
+        Function_Stmt(const Identifier& name, const std::span<const Identifier> arguments, const StmtList statements)
+            :m_name(name), m_arguments(arguments), m_statements(statements) {}
         void accept(Stmt_Visitor& visitor) override { visitor.visitFunctionStmt(*this); }
 };
 
 class Return_Stmt : public Stmt {
     public:
         Token m_keyword;
-        std::shared_ptr<Expr> m_value;
-        Return_Stmt(Token keyword, std::shared_ptr<Expr> value)
-            :m_keyword(std::move(keyword)), m_value(std::move(value)) {}
+        Expr* m_value;
+        // m_value when it is a call, which is then in tail position; set by the Resolver.
+        mutable const Call_Expr* m_tail_call = nullptr;
+        Return_Stmt(const Token& keyword, Expr* value)
+            :m_keyword(keyword), m_value(value) {}
         void accept(Stmt_Visitor& visitor) override { visitor.visitReturnStmt(*this); }
 };
 
+class Break_Stmt : public Stmt {
+    public:
+        Token m_keyword;
+        explicit Break_Stmt(const Token& keyword) :m_keyword(keyword) {}
+        void accept(Stmt_Visitor& visitor) override { visitor.visitBreakStmt(*this); }
+};
+
+class Continue_Stmt : public Stmt {
+    public:
+        Token m_keyword;
+        explicit Continue_Stmt(const Token& keyword) :m_keyword(keyword) {}
+        void accept(Stmt_Visitor& visitor) override { visitor.visitContinueStmt(*this); }
+};
+
+// One parsed script: the source text its tokens point into, and the arena holding its AST.
+// Functions keep pointing into the tree after interpretation, so a Program must outlive them.
+class Program {
+    public:
+        Source m_source;
+        Arena m_arena;
+        std::vector<Stmt*> m_statements;
+
+        explicit Program(Source&& source) : m_source(std::move(source)) {}
+};
+
 #endif // STATEMENT_HPP
@@ -3,19 +3,16 @@
 
 #pragma once
 
-#include <iostream>
-#include <string>
-#include <variant>
-#include <optional>
-
-class LoxCallable;
+#include "value.hpp"
 
-using Literal = std::variant<double, std::string, bool, std::shared_ptr<LoxCallable>>;
-using OptionalLiteral = std::optional<Literal>;
+#include <cstdint>
+#include <iostream>
+#include <string_view>
 
-enum class TokenType {
+enum class TokenType : uint8_t {
     LEFT_PAREN, RIGHT_PAREN,
     LEFT_BRACE, RIGHT_BRACE,
+    LEFT_BRACKET, RIGHT_BRACKET,
     COMMA, DOT, MINUS, PLUS, COLON,
     SEMICOLON, SLASH, STAR,
 
@@ -25,48 +22,52 @@ enum class TokenType {
 
     IDENTIFIER, STRING, NUMBER,
 
-    AND, CLASS, ELSE, FALSE, FUN, FOR,
+    AND, BREAK, CLASS, CONTINUE, ELSE, FALSE, FUN, FOR,
     IF, NIL, OR, PRINT, RETURN, SUPER,
     THIS, TRUE, VAR, WHILE,
 
     EndOfFile
 };
 
+// A scanned token: 16 bytes that locate the lexeme in the Program's source instead of copying
+// it. Literals are decoded by the parser, and only for tokens that end up in the AST.
 class Token {
     private:
         TokenType m_type {};
-        std::string m_lexeme {};
-        OptionalLiteral m_literal {};
-        size_t m_line {};
+        uint32_t m_offset {};
+        uint32_t m_length {};
+        uint32_t m_line {};
 
     public:
-        Token(TokenType type, const std::string& lexeme, const OptionalLiteral& literal, const size_t line) {
-            m_type = type;
-            m_lexeme = lexeme;
-            m_literal = literal;
-            m_line = line;
-        }
+        Token() = default;
+        Token(const TokenType type, const uint32_t offset, const uint32_t length, const uint32_t line)
+            : m_type(type), m_offset(offset), m_length(length), m_line(line) {}
 
         friend std::ostream& operator << (std::ostream& out, const Token &token) {
-            out << "Type: " << static_cast<int>(token.m_type) << " Lexeme: " << token.m_lexeme << " Line: " << token.m_line;
-            if (token.m_literal.has_value()) {
-                if (std::holds_alternative<double>(*token.m_literal)) {
-                    out << ", Value: " << std::get<double>(*token.m_literal) << ' ';
-                } else if (std::holds_alternative<std::string>(*token.m_literal)) {
-                    out << ", Value: " << std::get<std::string>(*token.m_literal) << ' ';
-                } else {
-                    out << ", Value: " << std::boolalpha << std::get<bool>(*token.m_literal) << ' ';
-                }
-            }
-            out << '\n';
+            out << "Type: " << static_cast<int>(token.m_type) << " Offset: " << token.m_offset
+                << " Length: " << token.m_length << " Line: " << token.m_line << '\n';
             return out;
         }
 
-        [[nodiscard]] const TokenType &type() const { return m_type; }
-        [[nodiscard]] const OptionalLiteral literal() const { return m_literal; }
-        [[nodiscard]] const std::string &lexeme() const { return m_lexeme; }
-        [[nodiscard]] const size_t line() const { return m_line; }
+        [[nodiscard]] TokenType type() const { return m_type; }
+        [[nodiscard]] std::string_view lexeme(const std::string_view source) const { return source.substr(m_offset, m_length); }
+        [[nodiscard]] size_t line() const { return m_line; }
+};
+
+static_assert(sizeof(Token) == 16, "Token should stay a compact record");
+
+// An identifier once parsed: its interned (pinned) name and the line it appeared on.
+class Identifier {
+    private:
+        ObjString* m_name;
+        uint32_t m_line;
+
+    public:
+        Identifier(ObjString* name, const size_t line) : m_name(name), m_line(static_cast<uint32_t>(line)) {}
 
+        [[nodiscard]] ObjString* name() const { return m_name; }
+        [[nodiscard]] std::string_view lexeme() const { return m_name->m_chars; }
+        [[nodiscard]] size_t line() const { return m_line; }
 };
 
 #endif //TOKEN_HPP
@@ -0,0 +1,88 @@
+
+#ifndef VALUE_HPP
+#define VALUE_HPP
+
+#pragma once
+
+#include "object.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+class ObjMap;
+
+// An 8-byte NaN-boxed runtime value. Doubles are stored as themselves; nil, booleans and
+// object pointers live in the payload of a quiet NaN that arithmetic never produces.
+class Value {
+    private:
+        static constexpr uint64_t SIGN_BIT = 0x8000000000000000;
+        static constexpr uint64_t QNAN = 0x7ffc000000000000;
+        static constexpr uint64_t TAG_NIL = 1;
+        static constexpr uint64_t TAG_FALSE = 2;
+        static constexpr uint64_t TAG_TRUE = 3;
+
+        uint64_t m_bits = QNAN | TAG_NIL;
+
+        explicit constexpr Value(const uint64_t bits, int) : m_bits(bits) {}
+
+    public:
+        constexpr Value() = default;
+
+        static Value number(const double number) {
+            uint64_t bits;
+            std::memcpy(&bits, &number, sizeof(bits));
+            return Value(bits, 0);
+        }
+        static constexpr Value boolean(const bool b) { return Value(QNAN | (b ? TAG_TRUE : TAG_FALSE), 0); }
+        static constexpr Value nil() { return {}; }
+        static Value object(Obj* obj) { return Value(SIGN_BIT | QNAN | reinterpret_cast<uintptr_t>(obj), 0); }
+
+        [[nodiscard]] bool isNumber() const { return (m_bits & QNAN) != QNAN; }
+        [[nodiscard]] bool isNil() const { return m_bits == (QNAN | TAG_NIL); }
+        [[nodiscard]] bool isBool() const { return (m_bits | 1) == (QNAN | TAG_TRUE); }
+        [[nodiscard]] bool isObj() const { return (m_bits & (QNAN | SIGN_BIT)) == (QNAN | SIGN_BIT); }
+        [[nodiscard]] bool isObjType(const ObjType type) const { return isObj() && asObj()->m_type == type; }
+        // Either representation: an interned ObjString or a runtime ObjConcat.
+        [[nodiscard]] bool isString() const {
+            return isObj() && (asObj()->m_type == ObjType::STRING || asObj()->m_type == ObjType::CONCAT);
+        }
+        [[nodiscard]] bool isArray() const { return isObjType(ObjType::ARRAY); }
+        [[nodiscard]] bool isMap() const { return isObjType(ObjType::MAP); }
+        [[nodiscard]] bool isCallable() const { return isObjType(ObjType::CALLABLE); }
+
+        [[nodiscard]] double asNumber() const {
+            double number;
+            std::memcpy(&number, &m_bits, sizeof(number));
+            return number;
+        }
+        [[nodiscard]] bool asBool() const { return m_bits == (QNAN | TAG_TRUE); }
+        [[nodiscard]] Obj* asObj() const { return reinterpret_cast<Obj*>(static_cast<uintptr_t>(m_bits & ~(SIGN_BIT | QNAN))); }
+        // Only for values known to be interned, such as literals; asChars() takes any string.
+        [[nodiscard]] ObjString* asString() const { return static_cast<ObjString*>(asObj()); }
+        [[nodiscard]] ObjArray* asArray() const { return static_cast<ObjArray*>(asObj()); }
+        // Defined in map.hpp.
+        [[nodiscard]] ObjMap* asMap() const;
+        [[nodiscard]] std::string_view asChars() const {
+            const Obj* obj = asObj();
+            return obj->m_type == ObjType::STRING ? std::string_view(static_cast<const ObjString*>(obj)->m_chars)
+                                                  : static_cast<const ObjConcat*>(obj)->chars();
+        }
+
+        [[nodiscard]] bool isFalsey() const { return isNil() || (isBool() && !asBool()); }
+
+        // Numbers compare by IEEE value, everything else by identity; interned strings are
+        // equal iff identical, so contents are only compared when a concatenation is involved.
+        friend bool operator==(const Value& lhs, const Value& rhs) {
+            if (lhs.isNumber() && rhs.isNumber()) { return lhs.asNumber() == rhs.asNumber(); }
+            if (lhs.m_bits == rhs.m_bits) { return true; }
+            if ((lhs.isObjType(ObjType::CONCAT) && rhs.isString()) || (rhs.isObjType(ObjType::CONCAT) && lhs.isString())) {
+                return lhs.asChars() == rhs.asChars();
+            }
+            return false;
+        }
+};
+
+static_assert(sizeof(Value) == 8, "Value must stay NaN-boxed");
+
+#endif //VALUE_HPP
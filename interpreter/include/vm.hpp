@@ -0,0 +1,97 @@
+
+#ifndef VM_HPP
+#define VM_HPP
+
+#pragma once
+
+#include "callable.hpp"
+#include "chunk.hpp"
+#include "memo.hpp"
+#include "profiler.hpp"
+#include "statement.hpp"
+#include "token.hpp"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class VmUpvalue {
+    public:
+        size_t m_slot;
+        Value m_closed {};
+        bool m_open = true;
+
+        explicit VmUpvalue(const size_t slot) : m_slot(slot) {}
+};
+
+class VmClosure final : public LoxCallable {
+    public:
+        std::shared_ptr<VmFunction> m_function;
+        std::vector<std::shared_ptr<VmUpvalue>> m_upvalues;
+        // Where results are cached, for a pure function under --memo.
+        MemoTable* m_memo = nullptr;
+
+        explicit VmClosure(std::shared_ptr<VmFunction> function)
+            : m_function(std::move(function)) { m_upvalues.reserve(m_function->m_upvalue_count); }
+        [[nodiscard]] size_t arity() const override { return m_function->m_arity; }
+        Value call(Interpreter &interpreter, std::span<const Value> arguments) override;
+        void trace(Heap& heap) override {
+            for (const auto& upvalue : m_upvalues) {
+                if (!upvalue->m_open) { heap.mark(upvalue->m_closed); }
+            }
+        }
+        [[nodiscard]] size_t byteSize() const override {
+            return sizeof(VmClosure) + m_function->m_upvalue_count * (sizeof(std::shared_ptr<VmUpvalue>) + sizeof(VmUpvalue));
+        }
+};
+
+// Stack-based virtual machine executing the bytecode produced by Compiler.
+class VM final : public GcRoots {
+    public:
+        VM();
+        ~VM() { heap().removeRoots(this); }
+        VM(const VM&) = delete;
+        VM& operator=(const VM&) = delete;
+        void interpret(StmtList statements);
+        void markRoots(Heap& heap) override;
+        void setProfiler(Profiler* profiler) { m_profiler = profiler; }
+        void setMemoizer(Memoizer* memoizer) { m_memoizer = memoizer; }
+
+    private:
+        static constexpr size_t STACK_INITIAL = 1024;
+        static constexpr size_t FRAMES_MAX = 100000;
+
+        struct CallFrame {
+            VmClosure* closure;
+            const uint8_t* ip;
+            size_t base;
+            // Set when the result is to be cached, under the arguments on top of m_memo_keys.
+            MemoTable* memo = nullptr;
+        };
+
+        std::vector<Value> m_stack;
+        size_t m_stack_top = 0;
+        std::vector<CallFrame> m_frames;
+        std::unordered_map<const ObjString*, Value, ObjStringHash> m_globals;
+        std::vector<std::shared_ptr<VmUpvalue>> m_open_upvalues;
+        Profiler* m_profiler = nullptr;
+        Memoizer* m_memoizer = nullptr;
+        // The arguments of memoized calls in progress, which the function may overwrite.
+        std::vector<Value> m_memo_keys;
+        size_t m_profiler_depth = 0;
+
+        void run();
+        void reserveStack(size_t needed);
+        std::shared_ptr<VmUpvalue> captureUpvalue(size_t slot);
+        void closeUpvalues(size_t from_slot);
+        Value& upvalueRef(VmUpvalue& upvalue) { return upvalue.m_open ? m_stack[upvalue.m_slot] : upvalue.m_closed; }
+        // Like Environment::overwrite: replacing a callable retires the memo tables depending on it.
+        void overwriteGlobal(const ObjString* name, Value& variable, const Value value) {
+            if (m_memoizer && variable.isCallable()) { m_memoizer->rebound(name); }
+            variable = value;
+        }
+        void reset();
+};
+
+#endif //VM_HPP
@@ -0,0 +1,187 @@
+#include "../include/array_kernels.hpp"
+
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define LOX_ARRAY_X86 1
+#include <immintrin.h>
+#endif
+
+// Lane j of the four accumulators takes elements 4k + j; the lanes are then combined as
+// (l0 + l2) + (l1 + l3), which is what the AVX2 horizontal add below computes.
+static double combine(const double lanes[4]) { return (lanes[0] + lanes[2]) + (lanes[1] + lanes[3]); }
+
+static double sumScalar(const double *values, const size_t count) {
+    double lanes[4] = {0, 0, 0, 0};
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        for (size_t j = 0; j < 4; ++j) { lanes[j] += values[i + j]; }
+    }
+    double total = combine(lanes);
+    for (; i < count; ++i) { total += values[i]; }
+    return total;
+}
+
+static double dotScalar(const double *lhs, const double *rhs, const size_t count) {
+    double lanes[4] = {0, 0, 0, 0};
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        for (size_t j = 0; j < 4; ++j) { lanes[j] += lhs[i + j] * rhs[i + j]; }
+    }
+    double total = combine(lanes);
+    for (; i < count; ++i) { total += lhs[i] * rhs[i]; }
+    return total;
+}
+
+template<bool Max>
+static double extremeScalar(const double *values, const size_t count) {
+    double best = values[0];
+    for (size_t i = 1; i < count; ++i) {
+        if (std::isnan(values[i])) { return values[i]; }
+        if (Max ? values[i] > best : values[i] < best) { best = values[i]; }
+    }
+    return best;
+}
+
+static double minScalar(const double *values, const size_t count) { return extremeScalar<false>(values, count); }
+static double maxScalar(const double *values, const size_t count) { return extremeScalar<true>(values, count); }
+
+static void scaleScalar(const double *values, const double factor, double *out, const size_t count) {
+    for (size_t i = 0; i < count; ++i) { out[i] = values[i] * factor; }
+}
+
+static void addScalar(const double *lhs, const double *rhs, double *out, const size_t count) {
+    for (size_t i = 0; i < count; ++i) { out[i] = lhs[i] + rhs[i]; }
+}
+
+// Blocks of four are scanned in-register as [a, a+b, (b+c)+a, (c+d)+(a+b)] and then offset by
+// the running total, the order the AVX2 version adds in.
+static void prefixSumScalar(const double *values, double *out, const size_t count) {
+    double carry = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const double a = values[i], b = values[i + 1], c = values[i + 2], d = values[i + 3];
+        const double ab = a + b;
+        out[i] = a + carry;
+        out[i + 1] = ab + carry;
+        out[i + 2] = ((b + c) + a) + carry;
+        out[i + 3] = ((c + d) + ab) + carry;
+        carry = out[i + 3];
+    }
+    for (; i < count; ++i) {
+        carry += values[i];
+        out[i] = carry;
+    }
+}
+
+#ifdef LOX_ARRAY_X86
+
+__attribute__((target("avx2")))
+static double horizontalSum(const __m256d lanes) {
+    // (l0 + l2) + (l1 + l3)
+    const __m128d pairs = _mm_add_pd(_mm256_castpd256_pd128(lanes), _mm256_extractf128_pd(lanes, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(pairs, _mm_unpackhi_pd(pairs, pairs)));
+}
+
+__attribute__((target("avx2")))
+static double sumAvx2(const double *values, const size_t count) {
+    __m256d lanes = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) { lanes = _mm256_add_pd(lanes, _mm256_loadu_pd(values + i)); }
+    double total = horizontalSum(lanes);
+    for (; i < count; ++i) { total += values[i]; }
+    return total;
+}
+
+__attribute__((target("avx2")))
+static double dotAvx2(const double *lhs, const double *rhs, const size_t count) {
+    __m256d lanes = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        lanes = _mm256_add_pd(lanes, _mm256_mul_pd(_mm256_loadu_pd(lhs + i), _mm256_loadu_pd(rhs + i)));
+    }
+    double total = horizontalSum(lanes);
+    for (; i < count; ++i) { total += lhs[i] * rhs[i]; }
+    return total;
+}
+
+template<bool Max>
+__attribute__((target("avx2")))
+static double extremeAvx2(const double *values, const size_t count) {
+    if (count < 8) { return extremeScalar<Max>(values, count); }
+    __m256d best = _mm256_loadu_pd(values);
+    __m256d nan = _mm256_cmp_pd(best, best, _CMP_UNORD_Q);
+    size_t i = 4;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d block = _mm256_loadu_pd(values + i);
+        nan = _mm256_or_pd(nan, _mm256_cmp_pd(block, block, _CMP_UNORD_Q));
+        best = Max ? _mm256_max_pd(best, block) : _mm256_min_pd(best, block);
+    }
+    if (_mm256_movemask_pd(nan) != 0) { return std::numeric_limits<double>::quiet_NaN(); }
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, best);
+    double result = extremeScalar<Max>(lanes, 4);
+    for (; i < count; ++i) {
+        if (std::isnan(values[i])) { return values[i]; }
+        if (Max ? values[i] > result : values[i] < result) { result = values[i]; }
+    }
+    return result;
+}
+
+static double minAvx2(const double *values, const size_t count) { return extremeAvx2<false>(values, count); }
+static double maxAvx2(const double *values, const size_t count) { return extremeAvx2<true>(values, count); }
+
+__attribute__((target("avx2")))
+static void scaleAvx2(const double *values, const double factor, double *out, const size_t count) {
+    const __m256d scale = _mm256_set1_pd(factor);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) { _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(values + i), scale)); }
+    for (; i < count; ++i) { out[i] = values[i] * factor; }
+}
+
+__attribute__((target("avx2")))
+static void addAvx2(const double *lhs, const double *rhs, double *out, const size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(lhs + i), _mm256_loadu_pd(rhs + i)));
+    }
+    for (; i < count; ++i) { out[i] = lhs[i] + rhs[i]; }
+}
+
+__attribute__((target("avx2")))
+static void prefixSumAvx2(const double *values, double *out, const size_t count) {
+    __m256d carry = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d x = _mm256_loadu_pd(values + i);
+        // x + [0, a, b, c] = [a, a+b, b+c, c+d]
+        const __m256d shifted = _mm256_blend_pd(_mm256_permute4x64_pd(x, _MM_SHUFFLE(2, 1, 0, 0)), _mm256_setzero_pd(), 0b0001);
+        const __m256d pairs = _mm256_add_pd(x, shifted);
+        // + [0, 0, a, a+b]
+        const __m256d scanned = _mm256_add_pd(pairs, _mm256_permute2f128_pd(pairs, pairs, 0x08));
+        const __m256d result = _mm256_add_pd(scanned, carry);
+        _mm256_storeu_pd(out + i, result);
+        carry = _mm256_permute4x64_pd(result, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+    double total = _mm256_cvtsd_f64(carry);
+    for (; i < count; ++i) {
+        total += values[i];
+        out[i] = total;
+    }
+}
+
+#endif
+
+const ArrayKernels &arrayKernels() {
+    static const ArrayKernels kernels = [] {
+#ifdef LOX_ARRAY_X86
+        if (__builtin_cpu_supports("avx2")) {
+            return ArrayKernels{sumAvx2, minAvx2, maxAvx2, dotAvx2, scaleAvx2, addAvx2, prefixSumAvx2, "avx2"};
+        }
+#endif
+        return ArrayKernels{sumScalar, minScalar, maxScalar, dotScalar, scaleScalar, addScalar, prefixSumScalar,
+                            "scalar"};
+    }();
+    return kernels;
+}
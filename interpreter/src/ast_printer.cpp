@@ -1,8 +1,39 @@
 #include "../include/ast_printer.hpp"
 
-std::string Ast_Printer::parenthesize(const std::string &name, const std::vector<std::shared_ptr<Expr>> &exprs) {
-    std::string result = "(" + name;
-    for (const auto &expr : exprs) {
+// Tokens no longer carry their text, so operators are printed from their type.
+static std::string_view spelling(const TokenType type) {
+    switch (type) {
+        case TokenType::MINUS: return "-";
+        case TokenType::PLUS: return "+";
+        case TokenType::SLASH: return "/";
+        case TokenType::STAR: return "*";
+        case TokenType::BANG: return "!";
+        case TokenType::BANG_EQUAL: return "!=";
+        case TokenType::EQUAL_EQUAL: return "==";
+        case TokenType::GREATER: return ">";
+        case TokenType::GREATER_EQUAL: return ">=";
+        case TokenType::LESS: return "<";
+        case TokenType::LESS_EQUAL: return "<=";
+        case TokenType::INCREMENT: return "++";
+        case TokenType::DECREMENT: return "--";
+        default: return "?";
+    }
+}
+
+std::string Ast_Printer::parenthesize(const std::string_view name, const std::initializer_list<const Expr *> exprs) {
+    std::string result = "(" + std::string(name);
+    for (const auto *expr : exprs) {
+        result += ' ';
+        expr->accept(*this);
+        result += m_output;
+    }
+    result += ')';
+    return result;
+}
+
+std::string Ast_Printer::parenthesize(const std::string_view name, const ExprList exprs) {
+    std::string result = "(" + std::string(name);
+    for (const auto *expr : exprs) {
         result += ' ';
         expr->accept(*this);
         result += m_output;
@@ -11,14 +42,14 @@ std::string Ast_Printer::parenthesize(const std::string &name, const std::vector
     return result;
 }
 
-std::string Ast_Printer::print(const std::shared_ptr<Expr> &expr) {
+std::string Ast_Printer::print(const Expr &expr) {
     m_output.clear();
-    expr->accept(*this);
+    expr.accept(*this);
     return m_output;
 }
 
 void Ast_Printer::visitBinaryExpr(const Binary_Expr &expr) {
-    m_output = parenthesize(expr.m_op.lexeme(), {expr.m_left, expr.m_right});
+    m_output = parenthesize(spelling(expr.m_op.type()), {expr.m_left, expr.m_right});
 }
 
 void Ast_Printer::visitGroupingExpr(const Grouping_Expr &expr) {
@@ -27,17 +58,17 @@ void Ast_Printer::visitGroupingExpr(const Grouping_Expr &expr) {
 }
 
 void Ast_Printer::visitLiteralExpr(const Literal_Expr &expr) {
-    if (!expr.m_value.has_value()) {
+    if (expr.m_value.isNil()) {
         m_output = "nil";
-    } else if (std::holds_alternative<double>(*expr.m_value)) {
-        m_output = std::to_string(std::get<double>(*expr.m_value));
-    } else if (std::holds_alternative<std::string>(*expr.m_value)) {
-        m_output = std::get<std::string>(*expr.m_value);
-    } else if (std::holds_alternative<bool>(*expr.m_value)) {
-        m_output = std::get<bool>(*expr.m_value) ? "true" : "false";
+    } else if (expr.m_value.isNumber()) {
+        m_output = std::to_string(expr.m_value.asNumber());
+    } else if (expr.m_value.isString()) {
+        m_output = expr.m_value.asString()->m_chars;
+    } else if (expr.m_value.isBool()) {
+        m_output = expr.m_value.asBool() ? "true" : "false";
     }
 }
 
 void Ast_Printer::visitUnaryExpr(const Unary_Expr &expr) {
-    m_output = parenthesize(expr.m_op.lexeme(), {expr.m_operand});
+    m_output = parenthesize(spelling(expr.m_op.type()), {expr.m_operand});
 }
@@ -2,15 +2,33 @@
 #include "../include/callable.hpp"
 #include "../include/interpreter.hpp"
 
-OptionalLiteral LoxFunction::call(Interpreter &interpreter, const std::vector<OptionalLiteral> &arguments) {
-    const auto env = std::make_shared<Environment>(m_closure);
-    for (size_t i = 0; i < m_declaration.m_arguments.size(); ++i) {
-        env->define(m_declaration.m_arguments[i].lexeme(), arguments[i]);
-    }
-    try {
-        interpreter.executeBlock(m_declaration.m_statements, env);
-    } catch (const ReturnException& e) {
-        return e.m_value;
+Value LoxFunction::call(Interpreter &interpreter, const std::span<const Value> arguments) {
+    if (!m_memo || !m_memo->caches(arguments)) { return run(interpreter, arguments); }
+    if (const Value *cached = m_memo->find(arguments)) { return *cached; }
+    // The arguments become the callee's parameters, which it may overwrite.
+    std::vector<Value> &keys = interpreter.memoKeys();
+    const size_t key = keys.size();
+    keys.insert(keys.end(), arguments.begin(), arguments.end());
+    const Value result = run(interpreter, arguments);
+    m_memo->insert({interpreter.memoKeys().data() + key, arguments.size()}, result);
+    keys.resize(key);
+    return result;
+}
+
+// A trampoline: when the body ends in a tail call, the callee runs next in this same loop
+// instead of nesting inside the body, so tail recursion takes constant C++ stack. Tail calls
+// skip the callee's memo table; the result is cached for the function first called.
+Value LoxFunction::run(Interpreter &interpreter, std::span<const Value> arguments) const {
+    const LoxFunction *function = this;
+    while (true) {
+        interpreter.executeCall(*function, arguments);
+        switch (interpreter.completion()) {
+            case Interpreter::Completion::RETURN: return interpreter.takeReturnValue();
+            case Interpreter::Completion::TAIL_CALL:
+                function = interpreter.takeTailCall();
+                arguments = interpreter.tailArguments();
+                break;
+            default: return Value::nil();
+        }
     }
-    return std::nullopt;
 }
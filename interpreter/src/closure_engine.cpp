@@ -0,0 +1,568 @@
+#include "../include/closure_engine.hpp"
+#include "../include/natives.hpp"
+#include "../include/operators.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+Value ClosureFunction::call(Interpreter &, std::span<const Value>) {
+    throw std::runtime_error("Compiled closures can only be called from the closure engine.");
+}
+
+ClosureEngine::ClosureEngine() {
+    heap().addRoots(this);
+    for (NativeFunction *native : natives()) {
+        m_globals->define(native->m_name, Value::object(native));
+    }
+}
+
+// Each statement is compiled just before it runs; only function bodies are kept.
+void ClosureEngine::interpret(const StmtList statements) {
+    if (m_profiler) { m_profiler_depth = m_profiler->depth(); }
+    try {
+        for (Stmt *stmt : statements) {
+            compile(stmt)();
+            m_frames.clear();
+        }
+    } catch (...) {
+        reset();
+        throw;
+    }
+}
+
+void ClosureEngine::markRoots(Heap &heap) {
+    heap.mark(m_globals);
+    m_frames.mark(heap);
+    for (const Value value : m_temps) { heap.mark(value); }
+    heap.mark(m_return);
+    heap.mark(m_tail_function);
+    for (const Value value : m_tail_arguments) { heap.mark(value); }
+    for (const Value value : m_memo_keys) { heap.mark(value); }
+}
+
+// A runtime error abandons whatever was executing; the REPL continues at global scope.
+void ClosureEngine::reset() {
+    if (m_profiler) { m_profiler->unwind(m_profiler_depth); }
+    m_frames.reset();
+    m_temps.clear();
+    m_memo_keys.clear();
+}
+
+CompiledExpr ClosureEngine::compile(const Expr *expr) {
+    expr->accept(*this);
+    return std::move(m_expr);
+}
+
+CompiledStmt ClosureEngine::compile(Stmt *stmt) {
+    if (!stmt) { return [] { return Completion::NORMAL; }; }
+    stmt->accept(*this);
+    return std::move(m_stmt);
+}
+
+CompiledStmt ClosureEngine::compile(const StmtList statements) {
+    std::vector<CompiledStmt> body;
+    for (Stmt *stmt : statements) {
+        if (stmt) { body.push_back(compile(stmt)); }
+    }
+    if (body.empty()) { return [] { return Completion::NORMAL; }; }
+    if (body.size() == 1) { return std::move(body.front()); }
+    return [body = std::move(body)] {
+        for (const CompiledStmt &stmt : body) {
+            if (const Completion completion = stmt(); completion != Completion::NORMAL) { return completion; }
+        }
+        return Completion::NORMAL;
+    };
+}
+
+// Operand shapes. Reading a constant or a local runs no code, so the collector can't run
+// between the two operands and the left one needs no rooting; MAY_COLLECT says otherwise.
+struct ClosureEngine::Constant {
+    static constexpr bool MAY_COLLECT = false;
+    Value value;
+    Value operator()() const { return value; }
+};
+
+struct ClosureEngine::Local {
+    static constexpr bool MAY_COLLECT = false;
+    ClosureEngine *engine;
+    size_t index;
+    Value operator()() const { return engine->m_frames.slot(index); }
+};
+
+struct ClosureEngine::Any {
+    static constexpr bool MAY_COLLECT = true;
+    CompiledExpr expr;
+    Value operator()() const { return expr(); }
+};
+
+template<Value (*Op)(Value, Value), typename Left, typename Right>
+CompiledExpr ClosureEngine::binary(Left left, Right right) {
+    return [this, left = std::move(left), right = std::move(right)] {
+        const Value l = left();
+        if constexpr (Right::MAY_COLLECT) {
+            if (l.isObj()) {
+                m_temps.push_back(l);
+                const Value r = right();
+                m_temps.pop_back();
+                return Op(l, r);
+            }
+        }
+        return Op(l, right());
+    };
+}
+
+template<Value (*Op)(Value, Value)>
+CompiledExpr ClosureEngine::binary(const Binary_Expr &expr) {
+    const auto shaped = [this](const Expr *operand, auto &&next) -> CompiledExpr {
+        if (const auto *literal = dynamic_cast<const Literal_Expr *>(operand)) {
+            return next(Constant{literal->m_value});
+        }
+        if (const auto *variable = dynamic_cast<const Variable_Expr *>(operand); variable && variable->m_depth == 0) {
+            return next(Local{this, variable->m_slot});
+        }
+        return next(Any{compile(operand)});
+    };
+    return shaped(expr.m_left, [&](auto left) {
+        return shaped(expr.m_right, [&](auto right) { return binary<Op>(std::move(left), std::move(right)); });
+    });
+}
+
+void ClosureEngine::visitBinaryExpr(const Binary_Expr &expr) {
+    switch (expr.m_op.type()) {
+        case TokenType::PLUS: m_expr = binary<binaryAdd>(expr); break;
+        case TokenType::MINUS: m_expr = binary<binarySubtract>(expr); break;
+        case TokenType::STAR: m_expr = binary<binaryMultiply>(expr); break;
+        case TokenType::SLASH: m_expr = binary<binaryDivide>(expr); break;
+        case TokenType::LESS: m_expr = binary<binaryLess>(expr); break;
+        case TokenType::LESS_EQUAL: m_expr = binary<binaryLessEqual>(expr); break;
+        case TokenType::GREATER: m_expr = binary<binaryGreater>(expr); break;
+        case TokenType::GREATER_EQUAL: m_expr = binary<binaryGreaterEqual>(expr); break;
+        case TokenType::EQUAL_EQUAL: m_expr = binary<binaryEqual>(expr); break;
+        case TokenType::BANG_EQUAL: m_expr = binary<binaryNotEqual>(expr); break;
+        default: throw std::runtime_error("Invalid binary operator");
+    }
+}
+
+void ClosureEngine::visitGroupingExpr(const Grouping_Expr &expr) {
+    if (expr.m_exprs.empty()) {
+        m_expr = [] { return Value::nil(); };
+    } else {
+        m_expr = compile(expr.m_exprs.front());
+    }
+}
+
+void ClosureEngine::visitLiteralExpr(const Literal_Expr &expr) {
+    m_expr = [value = expr.m_value] { return value; };
+}
+
+void ClosureEngine::visitUnaryExpr(const Unary_Expr &expr) {
+    CompiledExpr operand = compile(expr.m_operand);
+    switch (expr.m_op.type()) {
+        case TokenType::MINUS:
+            m_expr = [operand = std::move(operand)] {
+                const Value right = operand();
+                if (!right.isNumber()) { throw std::runtime_error("Invalid operand"); }
+                return Value::number(-right.asNumber());
+            };
+            return;
+        case TokenType::BANG:
+            m_expr = [operand = std::move(operand)] { return Value::boolean(!Interpreter::isTruthy(operand())); };
+            return;
+        case TokenType::INCREMENT:
+        case TokenType::DECREMENT: {
+            const auto *target = dynamic_cast<const Variable_Expr *>(expr.m_operand);
+            if (!target) {
+                m_expr = [operand = std::move(operand)]() -> Value {
+                    operand();
+                    throw std::runtime_error(R"(Invalid operand for either '++' or '--', must be a variable.)");
+                };
+                return;
+            }
+            const double delta = expr.m_op.type() == TokenType::INCREMENT ? 1.0 : -1.0;
+            m_expr = [this, operand = std::move(operand), delta, depth = expr.m_depth, index = expr.m_slot,
+                      name = &target->m_name] {
+                const Value right = operand();
+                if (!right.isNumber()) {
+                    throw std::runtime_error(R"(Invalid operand for either '++' or '--', must be a variable.)");
+                }
+                const Value result = Value::number(right.asNumber() + delta);
+                if (depth < 0) {
+                    m_globals->assign(*name, result);
+                } else {
+                    m_frames.variable(depth, index) = result;
+                }
+                return result;
+            };
+            return;
+        }
+        default:
+            m_expr = [operand = std::move(operand)]() -> Value {
+                operand();
+                throw std::runtime_error("Invalid unary operator");
+            };
+    }
+}
+
+void ClosureEngine::visitVariableExpr(const Variable_Expr &expr) {
+    const size_t index = expr.m_slot;
+    if (expr.m_depth < 0) {
+        m_expr = [this, name = &expr.m_name] { return m_globals->get(*name); };
+    } else if (expr.m_depth == 0) {
+        m_expr = [this, index] { return m_frames.slot(index); };
+    } else {
+        m_expr = [this, index] { return m_frames.captured(index); };
+    }
+}
+
+void ClosureEngine::visitAssignExpr(const Assign_Expr &expr) {
+    CompiledExpr value = compile(expr.m_value);
+    const size_t index = expr.m_slot;
+    if (expr.m_depth < 0) {
+        m_expr = [this, value = std::move(value), name = &expr.m_name] {
+            const Value result = value();
+            m_globals->assign(*name, result);
+            return result;
+        };
+    } else if (expr.m_depth == 0) {
+        m_expr = [this, value = std::move(value), index] {
+            const Value result = value();
+            m_frames.slot(index) = result;
+            return result;
+        };
+    } else {
+        m_expr = [this, value = std::move(value), index] {
+            const Value result = value();
+            m_frames.captured(index) = result;
+            return result;
+        };
+    }
+}
+
+void ClosureEngine::visitCallExpr(const Call_Expr &expr) { m_expr = call(expr); }
+
+// The callee is held in m_temps and the arguments pushed onto the value stack, where a Lox
+// function's frame starts.
+CompiledExpr ClosureEngine::call(const Call_Expr &expr) {
+    CompiledExpr callee = compile(expr.m_callee);
+    std::vector<CompiledExpr> arguments;
+    for (const Expr *argument : expr.m_args) {
+        arguments.push_back(compile(argument));
+    }
+    return [this, callee = std::move(callee), arguments = std::move(arguments), line = expr.m_paren.line()] {
+        m_temps.push_back(callee());
+        for (const CompiledExpr &argument : arguments) {
+            m_frames.push(argument());
+        }
+        const Value result = callValue(m_temps.back(), arguments.size(), line);
+        m_temps.pop_back();
+        return result;
+    };
+}
+
+// `return f(...)`: as Interpreter::tailCall, a closure is handed to the callFunction running
+// the current function as its next step, while anything else is called here.
+CompiledStmt ClosureEngine::tailCall(const Call_Expr &expr) {
+    CompiledExpr callee = compile(expr.m_callee);
+    std::vector<CompiledExpr> arguments;
+    for (const Expr *argument : expr.m_args) {
+        arguments.push_back(compile(argument));
+    }
+    return [this, callee = std::move(callee), arguments = std::move(arguments), line = expr.m_paren.line()] {
+        const Value function = callee();
+        m_temps.push_back(function);
+        for (const CompiledExpr &argument : arguments) {
+            m_frames.push(argument());
+        }
+        if (function.isCallable()) {
+            auto *closure = dynamic_cast<ClosureFunction *>(static_cast<LoxCallable *>(function.asObj()));
+            if (closure && closure->arity() == arguments.size()) {
+                if (m_profiler) { m_profiler->replace(profilerId(*closure), line); }
+                const std::span<const Value> args = m_frames.top(arguments.size());
+                m_tail_function = closure;
+                m_tail_arguments.assign(args.begin(), args.end());
+                m_frames.truncate(m_frames.size() - arguments.size());
+                m_temps.pop_back();
+                return Completion::TAIL_CALL;
+            }
+        }
+        m_return = callValue(function, arguments.size(), line);
+        m_temps.pop_back();
+        return Completion::RETURN;
+    };
+}
+
+void ClosureEngine::visitArrayExpr(const Array_Expr &expr) {
+    std::vector<CompiledExpr> elements;
+    for (const Expr *element : expr.m_elements) {
+        elements.push_back(compile(element));
+    }
+    m_expr = [this, elements = std::move(elements)] {
+        auto *array = heap().make<ObjArray>(elements.size());
+        m_temps.push_back(Value::object(array));
+        for (size_t i = 0; i < elements.size(); ++i) {
+            const Value element = elements[i]();
+            if (!element.isNumber()) { throw std::runtime_error("Array elements must be numbers."); }
+            array->m_values[i] = element.asNumber();
+        }
+        m_temps.pop_back();
+        return Value::object(array);
+    };
+}
+
+void ClosureEngine::visitIndexExpr(const Index_Expr &expr) {
+    m_expr = [this, object = compile(expr.m_object), index = compile(expr.m_index)] {
+        m_temps.push_back(object());
+        const Value result = getIndex(m_temps.back(), index());
+        m_temps.pop_back();
+        return result;
+    };
+}
+
+void ClosureEngine::visitIndexSetExpr(const IndexSet_Expr &expr) {
+    m_expr = [this, object = compile(expr.m_object), index = compile(expr.m_index), value = compile(expr.m_value)] {
+        m_temps.push_back(object());
+        m_temps.push_back(index());
+        m_temps.push_back(value());
+        const Value result = m_temps.back();
+        setIndex(m_temps[m_temps.size() - 3], m_temps[m_temps.size() - 2], result);
+        m_temps.resize(m_temps.size() - 3);
+        return result;
+    };
+}
+
+void ClosureEngine::visitExpressionStmt(const Expression_Stmt &stmt) {
+    if (!stmt.m_expression) {
+        m_stmt = [] {
+            std::cerr << "[ERROR] Null expression in Expression_Stmt.\n";
+            return Completion::NORMAL;
+        };
+        return;
+    }
+    m_stmt = [expression = compile(stmt.m_expression)] {
+        expression();
+        return Completion::NORMAL;
+    };
+}
+
+void ClosureEngine::visitPrintStmt(const Print_Stmt &stmt) {
+    m_stmt = [expression = compile(stmt.m_expression)] {
+        Interpreter::print(expression());
+        return Completion::NORMAL;
+    };
+}
+
+void ClosureEngine::visitVarStmt(const Var_Stmt &stmt) {
+    CompiledExpr value = stmt.m_value ? compile(stmt.m_value) : [] { return Value::nil(); };
+    if (stmt.m_slot < 0) {
+        m_stmt = [this, value = std::move(value), name = stmt.m_name.name()] {
+            m_globals->define(name, value());
+            return Completion::NORMAL;
+        };
+    } else {
+        m_stmt = [this, value = std::move(value), index = static_cast<size_t>(stmt.m_slot)] {
+            const Value initial = value();
+            m_frames.slot(index) = initial;
+            return Completion::NORMAL;
+        };
+    }
+}
+
+// Inside a function a block whose variables no closure captures needs nothing at runtime:
+// the call's frame already has its slots.
+void ClosureEngine::visitBlockStmt(const Block_Stmt &stmt) {
+    CompiledStmt body = compile(stmt.m_statements);
+    if (m_function_depth > 0 && !stmt.m_slots.captured) {
+        m_stmt = std::move(body);
+        return;
+    }
+    m_stmt = [this, body = std::move(body), slots = stmt.m_slots] {
+        m_frames.enterScope(slots);
+        const Completion completion = body();
+        m_frames.exitScope(slots);
+        return completion;
+    };
+}
+
+void ClosureEngine::visitIfStmt(const If_Stmt &stmt) {
+    CompiledExpr condition = compile(stmt.m_condition);
+    CompiledStmt then_branch = compile(stmt.m_then_branch);
+    if (!stmt.m_else_branch) {
+        m_stmt = [condition = std::move(condition), then_branch = std::move(then_branch)] {
+            return Interpreter::isTruthy(condition()) ? then_branch() : Completion::NORMAL;
+        };
+        return;
+    }
+    m_stmt = [condition = std::move(condition), then_branch = std::move(then_branch),
+              else_branch = compile(stmt.m_else_branch)] {
+        return Interpreter::isTruthy(condition()) ? then_branch() : else_branch();
+    };
+}
+
+void ClosureEngine::visitWhileStmt(const While_Stmt &stmt) {
+    m_stmt = [condition = compile(stmt.m_condition), body = compile(stmt.m_body)] {
+        while (Interpreter::isTruthy(condition())) {
+            const Completion completion = body();
+            if (completion == Completion::BREAK) { break; }
+            if (completion == Completion::RETURN || completion == Completion::TAIL_CALL) { return completion; }
+        }
+        return Completion::NORMAL;
+    };
+}
+
+void ClosureEngine::visitForStmt(const For_Stmt &stmt) {
+    CompiledStmt initializer = compile(stmt.m_initializer);
+    const auto *var_stmt = dynamic_cast<const Var_Stmt *>(stmt.m_initializer);
+    // The initializer's variable, which must start out as a number; -1 for none.
+    const int counter = var_stmt ? var_stmt->m_slot : -1;
+    CompiledExpr condition = stmt.m_condition ? compile(stmt.m_condition) : [] { return Value::boolean(true); };
+    CompiledExpr step = stmt.m_step ? compile(stmt.m_step) : [] { return Value::nil(); };
+    m_stmt = [this, initializer = std::move(initializer), counter, condition = std::move(condition),
+              body = compile(stmt.m_body), step = std::move(step), slots = stmt.m_slots] {
+        m_frames.enterScope(slots);
+        initializer();
+        if (counter >= 0 && !m_frames.slot(static_cast<size_t>(counter)).isNumber()) {
+            throw std::runtime_error("[ERROR] Unknown literal type for the for-loop initializer.");
+        }
+        Completion result = Completion::NORMAL;
+        while (Interpreter::isTruthy(condition())) {
+            const Completion completion = body();
+            if (completion == Completion::BREAK) { break; }
+            if (completion == Completion::RETURN || completion == Completion::TAIL_CALL) {
+                result = completion;
+                break;
+            }
+            step();
+        }
+        m_frames.exitScope(slots);
+        return result;
+    };
+}
+
+// The body is compiled the first time the declaration is, and shared from then on.
+void ClosureEngine::visitFunctionStmt(const Function_Stmt &stmt) {
+    std::unique_ptr<CompiledFunction> &compiled = m_functions[&stmt];
+    if (!compiled) {
+        compiled = std::make_unique<CompiledFunction>(CompiledFunction{stmt, {}});
+        m_function_depth++;
+        compiled->m_body = compile(stmt.m_statements);
+        m_function_depth--;
+    }
+    m_stmt = [this, &function = *compiled] {
+        const Function_Stmt &declaration = function.m_declaration;
+        MemoTable *memo = m_memoizer && declaration.m_pure
+            ? &m_memoizer->table(&declaration, declaration.m_name.lexeme(), declaration.m_name.line(),
+                                 declaration.m_arguments.size(), declaration.m_memo_deps)
+            : nullptr;
+        auto *closure = heap().make<ClosureFunction>(function, memo);
+        const Value value = Value::object(closure);
+        m_temps.push_back(value);
+        for (const Capture &capture : declaration.m_captures) {
+            closure->m_upvalues.push_back(m_frames.upvalue(capture));
+        }
+        m_temps.pop_back();
+        if (declaration.m_slot < 0) {
+            m_globals->define(declaration.m_name.name(), value);
+        } else {
+            m_frames.slot(static_cast<size_t>(declaration.m_slot)) = value;
+        }
+        return Completion::NORMAL;
+    };
+}
+
+void ClosureEngine::visitReturnStmt(const Return_Stmt &stmt) {
+    if (stmt.m_tail_call) {
+        m_stmt = tailCall(*stmt.m_tail_call);
+        return;
+    }
+    if (!stmt.m_value) {
+        m_stmt = [this] {
+            m_return = Value::nil();
+            return Completion::RETURN;
+        };
+        return;
+    }
+    m_stmt = [this, value = compile(stmt.m_value)] {
+        m_return = value();
+        return Completion::RETURN;
+    };
+}
+
+void ClosureEngine::visitBreakStmt(const Break_Stmt &) {
+    m_stmt = [] { return Completion::BREAK; };
+}
+
+void ClosureEngine::visitContinueStmt(const Continue_Stmt &) {
+    m_stmt = [] { return Completion::CONTINUE; };
+}
+
+Value ClosureEngine::callValue(const Value callee, const size_t count, const size_t call_line) {
+    if (!callee.isCallable()) {
+        throw std::runtime_error("Error, attempted to call a nil value.");
+    }
+    auto *callable = static_cast<LoxCallable *>(callee.asObj());
+    if (count != callable->arity()) {
+        throw std::runtime_error("Error, wrong number of arguments.");
+    }
+    auto *function = dynamic_cast<ClosureFunction *>(callable);
+    auto *native = function ? nullptr : dynamic_cast<NativeFunction *>(callable);
+    if (!function && !native) {
+        throw std::runtime_error("Error, attempted to call a nil value.");
+    }
+
+    const size_t base = m_frames.size() - count;
+    if (m_profiler) {
+        if (function) {
+            m_profiler->enter(profilerId(*function), call_line);
+        } else {
+            m_profiler->enter(m_profiler->function(native, native->m_name->m_chars, 0), call_line);
+        }
+    }
+    const Value result = function ? callFunction(*function, base) : native->m_function(m_frames.top(count));
+    if (m_profiler) { m_profiler->exit(); }
+    m_frames.truncate(base);
+    return result;
+}
+
+size_t ClosureEngine::profilerId(const ClosureFunction &function) const {
+    const Function_Stmt &declaration = function.m_function.m_declaration;
+    return m_profiler->function(&declaration, declaration.m_name.lexeme(), declaration.m_name.line());
+}
+
+// The arguments are on the stack from `base`, where they become the frame's parameters. Like
+// LoxFunction::run this is a trampoline for tail calls, and a result is cached for the
+// function first called.
+Value ClosureEngine::callFunction(ClosureFunction &function, const size_t base) {
+    const size_t arity = function.arity();
+    MemoTable *memo = function.m_memo;
+    const std::span<const Value> arguments = m_frames.top(arity);
+    if (memo && memo->caches(arguments)) {
+        if (const Value *cached = memo->find(arguments)) { return *cached; }
+        // The parameters may be overwritten, so the key is kept apart.
+        m_memo_keys.insert(m_memo_keys.end(), arguments.begin(), arguments.end());
+    } else {
+        memo = nullptr;
+    }
+
+    const ClosureFunction *current = &function;
+    Completion completion;
+    while ((completion = execute(*current, base)) == Completion::TAIL_CALL) {
+        current = m_tail_function;
+        m_frames.place(m_tail_arguments);
+    }
+    const Value result = completion == Completion::RETURN ? m_return : Value::nil();
+
+    if (memo) {
+        const size_t key = m_memo_keys.size() - arity;
+        memo->insert({m_memo_keys.data() + key, arity}, result);
+        m_memo_keys.resize(key);
+    }
+    return result;
+}
+
+ClosureEngine::Completion ClosureEngine::execute(const ClosureFunction &function, const size_t base) {
+    const FrameStack::Caller caller =
+        m_frames.enter(base, function.m_function.m_declaration.m_scope_size, function, function.m_upvalues);
+    const Completion completion = function.m_function.m_body();
+    m_frames.leave(caller);
+    return completion;
+}
@@ -0,0 +1,449 @@
+#include "../include/compiler.hpp"
+
+#include <limits>
+#include <stdexcept>
+
+std::shared_ptr<VmFunction> Compiler::compile(const StmtList statements) {
+    FunctionState script{std::make_shared<VmFunction>(), nullptr, {}, {}, 0, 1, {}};
+    script.locals.push_back({nullptr, 0, false}); // Slot 0 holds the running closure
+    m_current = &script;
+
+    for (const auto &stmt : statements) {
+        if (stmt) stmt->accept(*this);
+    }
+    emit(OpCode::NIL, 1);
+    emit(OpCode::RETURN, -1);
+
+    m_current = nullptr;
+    return script.function;
+}
+
+void Compiler::emit(const OpCode op, const int stack_effect) {
+    chunk().write(static_cast<uint8_t>(op), m_line);
+    m_current->stack_depth += stack_effect;
+    if (m_current->stack_depth > m_current->function->m_max_stack) {
+        m_current->function->m_max_stack = m_current->stack_depth;
+    }
+}
+
+void Compiler::emitByte(const uint8_t byte) { chunk().write(byte, m_line); }
+
+void Compiler::emitShort(const size_t value) {
+    if (value > std::numeric_limits<uint16_t>::max()) {
+        throw std::runtime_error("Line " + std::to_string(m_line) + ": Too many locals, array elements or jump distance in one function.");
+    }
+    emitByte(static_cast<uint8_t>(value >> 8));
+    emitByte(static_cast<uint8_t>(value & 0xff));
+}
+
+void Compiler::emitIndexed(const OpCode op, const OpCode long_op, const int stack_effect, const size_t index) {
+    if (index <= std::numeric_limits<uint16_t>::max()) {
+        emit(op, stack_effect);
+        emitShort(index);
+        return;
+    }
+    if (index >= size_t{1} << 24) {
+        throw std::runtime_error("Line " + std::to_string(m_line) + ": Too many constants or variables in one function.");
+    }
+    emit(long_op, stack_effect);
+    emitByte(static_cast<uint8_t>(index >> 16));
+    emitShort(index & 0xffff);
+}
+
+size_t Compiler::emitJump(const OpCode op, const int stack_effect) {
+    emit(op, stack_effect);
+    emitByte(0xff);
+    emitByte(0xff);
+    return chunk().m_code.size() - 2;
+}
+
+void Compiler::patchJump(const size_t offset) {
+    const size_t jump = chunk().m_code.size() - offset - 2;
+    if (jump > std::numeric_limits<uint16_t>::max()) {
+        throw std::runtime_error("Line " + std::to_string(m_line) + ": Too much code to jump over.");
+    }
+    chunk().m_code[offset] = static_cast<uint8_t>(jump >> 8);
+    chunk().m_code[offset + 1] = static_cast<uint8_t>(jump & 0xff);
+}
+
+void Compiler::emitLoop(const size_t loop_start) {
+    emit(OpCode::LOOP, 0);
+    emitShort(chunk().m_code.size() - loop_start + 2);
+}
+
+// Jumps out of the innermost loop body, first discarding the locals declared inside it.
+void Compiler::emitLoopExit(std::vector<size_t> Loop::* jumps) {
+    auto &loop = m_current->loops.back();
+    const size_t stack_depth = m_current->stack_depth;
+    for (size_t i = m_current->locals.size(); i-- > 1 && m_current->locals[i].depth > loop.scope_depth;) {
+        emit(m_current->locals[i].captured ? OpCode::CLOSE_UPVALUE : OpCode::POP, -1);
+    }
+    (loop.*jumps).push_back(emitJump(OpCode::JUMP, 0));
+    // Code after the jump is unreachable but still compiled with the body's locals in place.
+    m_current->stack_depth = stack_depth;
+}
+
+void Compiler::beginScope() { m_current->scope_depth++; }
+
+void Compiler::endScope() {
+    m_current->scope_depth--;
+    auto &locals = m_current->locals;
+    while (!locals.empty() && locals.back().depth > m_current->scope_depth) {
+        emit(locals.back().captured ? OpCode::CLOSE_UPVALUE : OpCode::POP, -1);
+        locals.pop_back();
+    }
+}
+
+void Compiler::declareVariable(const ObjString* name) {
+    m_current->locals.push_back({name, m_current->scope_depth, false});
+}
+
+// Binds the value on top of the stack to `name` in the current scope. Redeclaring a name in
+// the same scope overwrites it, like Environment::define does for the tree-walker.
+void Compiler::defineVariable(const ObjString* name) {
+    if (m_current->scope_depth == 0) {
+        emitIndexed(OpCode::DEFINE_GLOBAL, OpCode::DEFINE_GLOBAL_LONG, -1, chunk().addName(name));
+        return;
+    }
+    if (const int existing = resolveInScope(name); existing != -1) {
+        emit(OpCode::SET_LOCAL, 0);
+        emitShort(existing);
+        emit(OpCode::POP, -1);
+        return;
+    }
+    declareVariable(name);
+}
+
+int Compiler::resolveInScope(const ObjString* name) const {
+    const auto &locals = m_current->locals;
+    for (size_t i = locals.size(); i-- > 1;) {
+        if (locals[i].depth < m_current->scope_depth) { break; }
+        if (locals[i].name == name) { return static_cast<int>(i); }
+    }
+    return -1;
+}
+
+int Compiler::resolveLocal(const FunctionState &state, const ObjString* name) {
+    for (size_t i = state.locals.size(); i-- > 1;) {
+        if (state.locals[i].name == name) { return static_cast<int>(i); }
+    }
+    return -1;
+}
+
+int Compiler::addUpvalue(FunctionState &state, const uint16_t index, const bool is_local) {
+    for (size_t i = 0; i < state.upvalues.size(); ++i) {
+        if (state.upvalues[i].index == index && state.upvalues[i].is_local == is_local) {
+            return static_cast<int>(i);
+        }
+    }
+    state.upvalues.push_back({index, is_local});
+    state.function->m_upvalue_count = state.upvalues.size();
+    return static_cast<int>(state.upvalues.size() - 1);
+}
+
+int Compiler::resolveUpvalue(FunctionState &state, const ObjString* name) {
+    if (!state.enclosing) { return -1; }
+
+    if (const int local = resolveLocal(*state.enclosing, name); local != -1) {
+        state.enclosing->locals[local].captured = true;
+        return addUpvalue(state, static_cast<uint16_t>(local), true);
+    }
+    if (const int upvalue = resolveUpvalue(*state.enclosing, name); upvalue != -1) {
+        return addUpvalue(state, static_cast<uint16_t>(upvalue), false);
+    }
+    return -1;
+}
+
+void Compiler::emitGet(const Identifier &name) {
+    if (const int local = resolveLocal(*m_current, name.name()); local != -1) {
+        emit(OpCode::GET_LOCAL, 1);
+        emitShort(local);
+    } else if (const int upvalue = resolveUpvalue(*m_current, name.name()); upvalue != -1) {
+        emit(OpCode::GET_UPVALUE, 1);
+        emitShort(upvalue);
+    } else {
+        emitIndexed(OpCode::GET_GLOBAL, OpCode::GET_GLOBAL_LONG, 1, chunk().addName(name.name()));
+    }
+}
+
+void Compiler::emitSet(const Identifier &name) {
+    if (const int local = resolveLocal(*m_current, name.name()); local != -1) {
+        emit(OpCode::SET_LOCAL, 0);
+        emitShort(local);
+    } else if (const int upvalue = resolveUpvalue(*m_current, name.name()); upvalue != -1) {
+        emit(OpCode::SET_UPVALUE, 0);
+        emitShort(upvalue);
+    } else {
+        emitIndexed(OpCode::SET_GLOBAL, OpCode::SET_GLOBAL_LONG, 0, chunk().addName(name.name()));
+    }
+}
+
+void Compiler::compileFunction(const Function_Stmt &stmt) {
+    FunctionState state{std::make_shared<VmFunction>(), m_current, {}, {}, 1, 1, {}};
+    state.function->m_name = std::string(stmt.m_name.lexeme());
+    state.function->m_line = stmt.m_name.line();
+    state.function->m_arity = stmt.m_arguments.size();
+    state.function->m_declaration = &stmt;
+    state.function->m_pure = stmt.m_pure;
+    state.function->m_memo_deps = stmt.m_memo_deps;
+    state.locals.push_back({nullptr, 0, false});
+    m_current = &state;
+
+    for (const auto &param : stmt.m_arguments) {
+        defineVariable(param.name());
+        m_current->stack_depth++;
+    }
+    for (const auto &body_stmt : stmt.m_statements) {
+        if (body_stmt) body_stmt->accept(*this);
+    }
+    emit(OpCode::NIL, 1);
+    emit(OpCode::RETURN, -1);
+
+    m_current = state.enclosing;
+    m_line = stmt.m_name.line();
+    emitIndexed(OpCode::CLOSURE, OpCode::CLOSURE_LONG, 1, chunk().addFunction(state.function));
+    for (const auto &upvalue : state.upvalues) {
+        emitByte(upvalue.is_local ? 1 : 0);
+        emitShort(upvalue.index);
+    }
+}
+
+void Compiler::visitBinaryExpr(const Binary_Expr &expr) {
+    expr.m_left->accept(*this);
+    expr.m_right->accept(*this);
+    m_line = expr.m_op.line();
+
+    switch (expr.m_op.type()) {
+        case TokenType::EQUAL_EQUAL: emit(OpCode::EQUAL, -1); break;
+        case TokenType::BANG_EQUAL: emit(OpCode::NOT_EQUAL, -1); break;
+        case TokenType::GREATER: emit(OpCode::GREATER, -1); break;
+        case TokenType::GREATER_EQUAL: emit(OpCode::GREATER_EQUAL, -1); break;
+        case TokenType::LESS: emit(OpCode::LESS, -1); break;
+        case TokenType::LESS_EQUAL: emit(OpCode::LESS_EQUAL, -1); break;
+        case TokenType::PLUS: emit(OpCode::ADD, -1); break;
+        case TokenType::MINUS: emit(OpCode::SUBTRACT, -1); break;
+        case TokenType::STAR: emit(OpCode::MULTIPLY, -1); break;
+        case TokenType::SLASH: emit(OpCode::DIVIDE, -1); break;
+        default:
+            throw std::runtime_error("Invalid binary operator");
+    }
+}
+
+void Compiler::visitGroupingExpr(const Grouping_Expr &expr) {
+    if (expr.m_exprs.empty()) {
+        emit(OpCode::NIL, 1);
+    } else {
+        expr.m_exprs.front()->accept(*this);
+    }
+}
+
+void Compiler::visitLiteralExpr(const Literal_Expr &expr) {
+    if (expr.m_value.isNil()) {
+        emit(OpCode::NIL, 1);
+    } else if (expr.m_value.isBool()) {
+        emit(expr.m_value.asBool() ? OpCode::TRUE : OpCode::FALSE, 1);
+    } else {
+        emitIndexed(OpCode::CONSTANT, OpCode::CONSTANT_LONG, 1, chunk().addConstant(expr.m_value));
+    }
+}
+
+void Compiler::visitUnaryExpr(const Unary_Expr &expr) {
+    m_line = expr.m_op.line();
+    switch (expr.m_op.type()) {
+        case TokenType::MINUS:
+            expr.m_operand->accept(*this);
+            emit(OpCode::NEGATE, 0);
+            break;
+        case TokenType::BANG:
+            expr.m_operand->accept(*this);
+            emit(OpCode::NOT, 0);
+            break;
+        case TokenType::INCREMENT:
+        case TokenType::DECREMENT: {
+            const auto var_expr = dynamic_cast<const Variable_Expr *>(expr.m_operand);
+            if (!var_expr) {
+                throw std::runtime_error(R"(Invalid operand for either '++' or '--', must be a variable.)");
+            }
+            emitGet(var_expr->m_name);
+            emit(expr.m_op.type() == TokenType::INCREMENT ? OpCode::INCREMENT : OpCode::DECREMENT, 0);
+            emitSet(var_expr->m_name);
+            break;
+        }
+        default:
+            throw std::runtime_error("Invalid unary operator");
+    }
+}
+
+void Compiler::visitVariableExpr(const Variable_Expr &expr) {
+    m_line = expr.m_name.line();
+    emitGet(expr.m_name);
+}
+
+void Compiler::visitAssignExpr(const Assign_Expr &expr) {
+    expr.m_value->accept(*this);
+    m_line = expr.m_name.line();
+    emitSet(expr.m_name);
+}
+
+void Compiler::visitCallExpr(const Call_Expr &expr) { emitCall(expr, OpCode::CALL); }
+
+void Compiler::emitCall(const Call_Expr &expr, const OpCode op) {
+    expr.m_callee->accept(*this);
+    for (const auto &arg : expr.m_args) {
+        arg->accept(*this);
+    }
+    m_line = expr.m_paren.line();
+    emit(op, -static_cast<int>(expr.m_args.size()));
+    emitByte(static_cast<uint8_t>(expr.m_args.size()));
+}
+
+void Compiler::visitArrayExpr(const Array_Expr &expr) {
+    for (const auto &element : expr.m_elements) {
+        element->accept(*this);
+    }
+    m_line = expr.m_bracket.line();
+    emit(OpCode::ARRAY, 1 - static_cast<int>(expr.m_elements.size()));
+    emitShort(expr.m_elements.size());
+}
+
+void Compiler::visitIndexExpr(const Index_Expr &expr) {
+    expr.m_object->accept(*this);
+    expr.m_index->accept(*this);
+    m_line = expr.m_bracket.line();
+    emit(OpCode::GET_INDEX, -1);
+}
+
+void Compiler::visitIndexSetExpr(const IndexSet_Expr &expr) {
+    expr.m_object->accept(*this);
+    expr.m_index->accept(*this);
+    expr.m_value->accept(*this);
+    m_line = expr.m_bracket.line();
+    emit(OpCode::SET_INDEX, -2);
+}
+
+void Compiler::visitExpressionStmt(const Expression_Stmt &stmt) {
+    if (!stmt.m_expression) { return; }
+    stmt.m_expression->accept(*this);
+    emit(OpCode::POP, -1);
+}
+
+void Compiler::visitPrintStmt(const Print_Stmt &stmt) {
+    stmt.m_expression->accept(*this);
+    emit(OpCode::PRINT, -1);
+}
+
+void Compiler::visitVarStmt(const Var_Stmt &stmt) {
+    if (stmt.m_value) {
+        stmt.m_value->accept(*this);
+    } else {
+        emit(OpCode::NIL, 1);
+    }
+    m_line = stmt.m_name.line();
+    defineVariable(stmt.m_name.name());
+}
+
+void Compiler::visitBlockStmt(const Block_Stmt &stmt) {
+    beginScope();
+    for (const auto &inner : stmt.m_statements) {
+        if (inner) inner->accept(*this);
+    }
+    endScope();
+}
+
+void Compiler::visitIfStmt(const If_Stmt &stmt) {
+    stmt.m_condition->accept(*this);
+    const size_t then_jump = emitJump(OpCode::JUMP_IF_FALSE, -1);
+    stmt.m_then_branch->accept(*this);
+
+    if (stmt.m_else_branch) {
+        const size_t else_jump = emitJump(OpCode::JUMP, 0);
+        patchJump(then_jump);
+        stmt.m_else_branch->accept(*this);
+        patchJump(else_jump);
+    } else {
+        patchJump(then_jump);
+    }
+}
+
+void Compiler::visitWhileStmt(const While_Stmt &stmt) {
+    const size_t loop_start = chunk().m_code.size();
+    stmt.m_condition->accept(*this);
+    const size_t exit_jump = emitJump(OpCode::JUMP_IF_FALSE, -1);
+    m_current->loops.push_back({m_current->scope_depth, {}, {}});
+    stmt.m_body->accept(*this);
+    for (const size_t jump : m_current->loops.back().continue_jumps) { patchJump(jump); }
+    emitLoop(loop_start);
+    patchJump(exit_jump);
+    for (const size_t jump : m_current->loops.back().break_jumps) { patchJump(jump); }
+    m_current->loops.pop_back();
+}
+
+void Compiler::visitForStmt(const For_Stmt &stmt) {
+    beginScope();
+    if (stmt.m_initializer) {
+        stmt.m_initializer->accept(*this);
+        if (const auto var_stmt = dynamic_cast<const Var_Stmt *>(stmt.m_initializer)) {
+            emitGet(var_stmt->m_name);
+            emit(OpCode::CHECK_NUMBER, 0);
+            emit(OpCode::POP, -1);
+        }
+    }
+
+    const size_t loop_start = chunk().m_code.size();
+    size_t exit_jump = 0;
+    if (stmt.m_condition) {
+        stmt.m_condition->accept(*this);
+        exit_jump = emitJump(OpCode::JUMP_IF_FALSE, -1);
+    }
+    m_current->loops.push_back({m_current->scope_depth, {}, {}});
+    stmt.m_body->accept(*this);
+    for (const size_t jump : m_current->loops.back().continue_jumps) { patchJump(jump); }
+    if (stmt.m_step) {
+        stmt.m_step->accept(*this);
+        emit(OpCode::POP, -1);
+    }
+    emitLoop(loop_start);
+    if (stmt.m_condition) {
+        patchJump(exit_jump);
+    }
+    for (const size_t jump : m_current->loops.back().break_jumps) { patchJump(jump); }
+    m_current->loops.pop_back();
+    endScope();
+}
+
+void Compiler::visitFunctionStmt(const Function_Stmt &stmt) {
+    const ObjString* name = stmt.m_name.name();
+    if (m_current->scope_depth > 0 && resolveInScope(name) == -1) {
+        // Declare first so the body can refer to itself; CLOSURE then fills the new slot.
+        declareVariable(name);
+        compileFunction(stmt);
+        return;
+    }
+    compileFunction(stmt);
+    defineVariable(name);
+}
+
+void Compiler::visitReturnStmt(const Return_Stmt &stmt) {
+    m_line = stmt.m_keyword.line();
+    if (!m_current->enclosing) {
+        throw std::runtime_error("Line " + std::to_string(m_line) + ": Can't return from top-level code.");
+    }
+    if (stmt.m_tail_call) {
+        emitCall(*stmt.m_tail_call, OpCode::TAIL_CALL);
+    } else if (stmt.m_value) {
+        stmt.m_value->accept(*this);
+    } else {
+        emit(OpCode::NIL, 1);
+    }
+    emit(OpCode::RETURN, -1);
+}
+
+void Compiler::visitBreakStmt(const Break_Stmt &stmt) {
+    m_line = stmt.m_keyword.line();
+    emitLoopExit(&Loop::break_jumps);
+}
+
+void Compiler::visitContinueStmt(const Continue_Stmt &stmt) {
+    m_line = stmt.m_keyword.line();
+    emitLoopExit(&Loop::continue_jumps);
+}
@@ -1,48 +1,82 @@
+#include <algorithm>
 #include <utility>
 
 #include "../include/interpreter.hpp"
 #include "../include/callable.hpp"
+#include "../include/map.hpp"
+#include "../include/natives.hpp"
+#include "../include/operators.hpp"
 #include "../include/statement.hpp"
 
-void Interpreter::interpret(const std::vector<std::shared_ptr<Stmt>>& statements) {
-    for (const auto& stmt: statements) {
-        stmt->accept(*this);
+Interpreter::Interpreter() {
+    heap().addRoots(this);
+    for (NativeFunction *native : natives()) {
+        m_globals->define(native->m_name, Value::object(native));
     }
 }
 
+void Interpreter::interpret(const StmtList statements) {
+    try {
+        for (const auto& stmt: statements) {
+            stmt->accept(*this);
+            m_frames.clear();
+        }
+    } catch (...) {
+        // A runtime error abandons whatever was executing; the REPL continues at global scope.
+        m_frames.reset();
+        m_temps.clear();
+        m_memo_keys.clear();
+        m_completion = Completion::NORMAL;
+        throw;
+    }
+}
+
+void Interpreter::markRoots(Heap &heap) {
+    heap.mark(m_globals);
+    m_frames.mark(heap);
+    for (const Value value : m_temps) { heap.mark(value); }
+    heap.mark(m_tail_function);
+    for (const Value value : m_tail_arguments) { heap.mark(value); }
+    for (const Value value : m_memo_keys) { heap.mark(value); }
+    heap.mark(m_result);
+}
+
 void Interpreter::visitLiteralExpr(const Literal_Expr &expr) { m_result = expr.m_value; }
 
 void Interpreter::visitUnaryExpr(const Unary_Expr &expr) {
     expr.m_operand->accept(*this);
-    const OptionalLiteral right = m_result;
+    const Value right = m_result;
 
     switch (expr.m_op.type()) {
         case TokenType::MINUS:{
-            if (!right || !std::holds_alternative<double>(*right)) {
+            if (!right.isNumber()) {
                 throw std::runtime_error("Invalid operand");
             }
-            m_result = - std::get<double>(*right);
+            m_result = Value::number(-right.asNumber());
             break;
         }
         case TokenType::BANG: {
-            m_result = isTruthy(right);
+            m_result = Value::boolean(!isTruthy(right));
             break;
         }
         case TokenType::INCREMENT:
         case TokenType::DECREMENT: {
-            const auto var_expr = std::dynamic_pointer_cast<Variable_Expr>(expr.m_operand);
+            const auto var_expr = dynamic_cast<const Variable_Expr*>(expr.m_operand);
             if (!var_expr) {
                 throw std::runtime_error(R"(Invalid operand for either '++' or '--', must be a variable.)");
             }
-            OptionalLiteral value = m_environment->get(var_expr->m_name);
-            if (!value || !std::holds_alternative<double>(*value)) {
+            if (!right.isNumber()) {
                 throw std::runtime_error(R"(Invalid operand for either '++' or '--', must be a variable.)");
             }
 
             const double delta = (expr.m_op.type() == TokenType::INCREMENT) ? 1.0 : -1.0;
-            double result = std::get<double>(*value) + delta;
+            const Value result = Value::number(right.asNumber() + delta);
 
-            m_environment->assign(var_expr->m_name, result);
+            if (expr.m_depth < 0) {
+                m_globals->assign(var_expr->m_name, result);
+            } else {
+                m_frames.variable(expr.m_depth, expr.m_slot) = result;
+            }
             m_result = result;
             break;
         }
@@ -51,115 +85,172 @@ void Interpreter::visitUnaryExpr(const Unary_Expr &expr) {
     }
 }
 
+// The specialized evaluator for a site whose first operands were `left` and `right`.
+static Binary_Expr::Quick quicken(const TokenType type, const Value left, const Value right) {
+    using enum Binary_Expr::Quick;
+    if (left.isString() && right.isString()) { return type == TokenType::PLUS ? STRING_CONCAT : GENERIC; }
+    if (!left.isNumber() || !right.isNumber()) { return GENERIC; }
+    switch (type) {
+        case TokenType::PLUS: return NUMBER_ADD;
+        case TokenType::MINUS: return NUMBER_SUBTRACT;
+        case TokenType::STAR: return NUMBER_MULTIPLY;
+        case TokenType::SLASH: return NUMBER_DIVIDE;
+        case TokenType::LESS: return NUMBER_LESS;
+        case TokenType::LESS_EQUAL: return NUMBER_LESS_EQUAL;
+        case TokenType::GREATER: return NUMBER_GREATER;
+        case TokenType::GREATER_EQUAL: return NUMBER_GREATER_EQUAL;
+        case TokenType::EQUAL_EQUAL: return NUMBER_EQUAL;
+        case TokenType::BANG_EQUAL: return NUMBER_NOT_EQUAL;
+        default: return GENERIC;
+    }
+}
+
 void Interpreter::visitBinaryExpr(const Binary_Expr &expr) {
     expr.m_left->accept(*this);
-    const OptionalLiteral left = m_result;
+    const Value left = m_result;
+    m_temps.push_back(left);
     expr.m_right->accept(*this);
-    const OptionalLiteral right = m_result;
-
-    const auto type = expr.m_op.type();
-
-    if (!left || !right) { throw std::runtime_error("Operands must not be nil."); }
-
-    if (type == TokenType::EQUAL_EQUAL || type == TokenType::BANG_EQUAL) {
-        bool eq = isEqual(left, right);
-        m_result = (type == TokenType::EQUAL_EQUAL) ? eq : !eq;
-    }
-
-    if (type == TokenType::PLUS) {
-        if (std::holds_alternative<double>(*left) && std::holds_alternative<double>(*right)) {
-            m_result = std::get<double>(*left) + std::get<double>(*right);
-        } else if (std::holds_alternative<std::string>(*left) && std::holds_alternative<std::string>(*right)) {
-            m_result = std::get<std::string>(*left) + std::get<std::string>(*right);
-        } else {
-            throw std::runtime_error("Operands must either be numbers or two strings.");
+    const Value right = m_result;
+    m_temps.pop_back();
+
+    // The quickened forms skip the dispatch on the operator; the operators themselves are
+    // shared with the closure engine (see operators.hpp).
+    using enum Binary_Expr::Quick;
+    if (left.isNumber() && right.isNumber()) {
+        switch (expr.m_quick) {
+            case NUMBER_ADD: m_result = binaryAdd(left, right); return;
+            case NUMBER_SUBTRACT: m_result = binarySubtract(left, right); return;
+            case NUMBER_MULTIPLY: m_result = binaryMultiply(left, right); return;
+            case NUMBER_DIVIDE: m_result = binaryDivide(left, right); return;
+            case NUMBER_LESS: m_result = binaryLess(left, right); return;
+            case NUMBER_LESS_EQUAL: m_result = binaryLessEqual(left, right); return;
+            case NUMBER_GREATER: m_result = binaryGreater(left, right); return;
+            case NUMBER_GREATER_EQUAL: m_result = binaryGreaterEqual(left, right); return;
+            case NUMBER_EQUAL: m_result = binaryEqual(left, right); return;
+            case NUMBER_NOT_EQUAL: m_result = binaryNotEqual(left, right); return;
+            default: break;
         }
+    } else if (expr.m_quick == STRING_CONCAT && left.isString() && right.isString()) {
+        m_result = binaryAdd(left, right);
+        return;
     }
 
-    if (type == TokenType::STAR) {
-        if (std::holds_alternative<std::string>(*left) && std::holds_alternative<double>(*right)) {
-            const double times = std::get<double>(*right);
-            auto str = std::get<std::string>(*left);
-            std::string result;
-            for (size_t i = 0; i < times; i++) { result += str; }
-            m_result = result;
-        } else if (std::holds_alternative<double>(*left) && std::holds_alternative<std::string>(*right)) {
-            const double times = std::get<double>(*left);
-            std::string str = std::get<std::string>(*left);
-            std::string result = str;
-            for (size_t i = 0; i < times; i++) { result += str; }
-            m_result = result;
-        } else if (std::holds_alternative<double>(*left) && std::holds_alternative<double>(*right)) {
-            m_result = std::get<double>(*left) * std::get<double>(*right);
-        } else {
-            throw std::runtime_error("Unsupported operands for \'*\'");
-        }
-    }
+    // Chosen before evaluating, which may allocate and so collect the operands, but only
+    // applied once evaluation succeeded and the operands proved valid for the operator.
+    const Binary_Expr::Quick quick = expr.m_quick == UNSEEN ? quicken(expr.m_op.type(), left, right) : GENERIC;
+    const BinaryOperator op = binaryOperator(expr.m_op.type());
+    if (!op) { throw std::runtime_error("Invalid binary operator"); }
+    m_result = op(left, right);
+    expr.m_quick = quick;
+}
 
-    if (type == TokenType::MINUS || type == TokenType::SLASH) {
-        if (!std::holds_alternative<double>(*left) || !std::holds_alternative<double>(*right)) {
-            throw std::runtime_error("Operands must not be numbers.");
-        }
-        if (type == TokenType::MINUS) {
-            m_result = std::get<double>(*left) - std::get<double>(*right);
-        } else {
-            if (std::get<double>(*right) == 0.0) { throw std::runtime_error("Error! Division by zero."); }
-            m_result = std::get<double>(*left) / std::get<double>(*right);
-        }
-    }
-    if (type == TokenType::GREATER || type == TokenType::GREATER_EQUAL ||
-        type == TokenType::LESS || type == TokenType::LESS_EQUAL) {
-        if (std::holds_alternative<double>(*left) && std::holds_alternative<double>(*right)) {
-            const double l = std::get<double>(*left);
-            const double r = std::get<double>(*right);
-            if (type == TokenType::GREATER)        m_result = l > r;
-            else if (type == TokenType::GREATER_EQUAL) m_result = l >= r;
-            else if (type == TokenType::LESS)          m_result = l < r;
-            else if (type == TokenType::LESS_EQUAL)    m_result = l <= r;
-        } else if (std::holds_alternative<std::string>(*left) && std::holds_alternative<std::string>(*right)) {
-            const auto l = std::get<std::string>(*left);
-            const auto r = std::get<std::string>(*right);
-            if (type == TokenType::GREATER) { m_result = l > r; }
-            else if (type == TokenType::GREATER_EQUAL) { m_result = l >= r; }
-            else if (type == TokenType::LESS) { m_result = l < r; }
-            else m_result = l <= r;
-        } else {
-            throw std::runtime_error("Operands for comparison must either be two numbers or two strings.");
-        }
+void Interpreter::visitArrayExpr(const Array_Expr &expr) {
+    auto *array = heap().make<ObjArray>(expr.m_elements.size());
+    m_temps.push_back(Value::object(array));
+    for (size_t i = 0; i < expr.m_elements.size(); ++i) {
+        expr.m_elements[i]->accept(*this);
+        if (!m_result.isNumber()) { throw std::runtime_error("Array elements must be numbers."); }
+        array->m_values[i] = m_result.asNumber();
     }
+    m_temps.pop_back();
+    m_result = Value::object(array);
+}
+
+void Interpreter::visitIndexExpr(const Index_Expr &expr) {
+    expr.m_object->accept(*this);
+    const Value object = m_result;
+    m_temps.push_back(object);
+    expr.m_index->accept(*this);
+    m_temps.pop_back();
+    m_result = getIndex(object, m_result);
+}
+
+void Interpreter::visitIndexSetExpr(const IndexSet_Expr &expr) {
+    expr.m_object->accept(*this);
+    const Value object = m_result;
+    m_temps.push_back(object);
+    expr.m_index->accept(*this);
+    const Value index = m_result;
+    m_temps.push_back(index);
+    expr.m_value->accept(*this);
+    m_temps.push_back(m_result);
+    setIndex(object, index, m_result);
+    m_temps.resize(m_temps.size() - 3);
 }
 
 void Interpreter::visitGroupingExpr(const Grouping_Expr &expr) {
     if (expr.m_exprs.empty()) {
-        m_result = std::nullopt;
+        m_result = Value::nil();
     } else {
         expr.m_exprs.front()->accept(*this);
     }
 }
 
 void Interpreter::visitVarStmt(const Var_Stmt &stmt) {
-    OptionalLiteral value = std::nullopt;
+    Value value = Value::nil();
     if (stmt.m_value) {
         stmt.m_value->accept(*this);
         value = m_result;
     }
-    m_environment->define(stmt.m_name.lexeme(), value);
+    if (stmt.m_slot < 0) {
+        m_globals->define(stmt.m_name.name(), value);
+    } else {
+        m_frames.slot(stmt.m_slot) = value;
+    }
 }
 
 void Interpreter::visitPrintStmt(const Print_Stmt& stmt) {
     stmt.m_expression->accept(*this);
+    print(m_result);
+}
 
-    if (const OptionalLiteral value = m_result; !value.has_value()) {
-        std::cout << "nil\n";
-    } else if (std::holds_alternative<double>(*value)) {
-        std::cout << std::get<double>(*value) << '\n';
-    } else if (std::holds_alternative<std::string>(*value)) {
-        std::cout << std::get<std::string>(*value) << '\n';
-    } else if (std::holds_alternative<bool>(*value)) {
-        std::cout << std::boolalpha << std::get<bool>(*value) << '\n';
+// Writes a printable value; `open` holds the maps being written, so a map that contains
+// itself prints as {...} instead of recursing forever.
+static void writeValue(std::ostream &out, const Value value, std::vector<const ObjMap *> &open) {
+    if (value.isNil()) {
+        out << "nil";
+    } else if (value.isNumber()) {
+        out << value.asNumber();
+    } else if (value.isString()) {
+        out << value.asChars();
+    } else if (value.isBool()) {
+        out << std::boolalpha << value.asBool();
+    } else if (value.isArray()) {
+        const auto &values = value.asArray()->m_values;
+        out << '[';
+        for (size_t i = 0; i < values.size(); ++i) {
+            out << (i ? ", " : "") << values[i];
+        }
+        out << ']';
+    } else if (value.isMap()) {
+        const ObjMap *map = value.asMap();
+        if (std::ranges::find(open, map) != open.end()) {
+            out << "{...}";
+            return;
+        }
+        open.push_back(map);
+        out << '{';
+        for (size_t i = 0; i < map->size(); ++i) {
+            out << (i ? ", " : "");
+            writeValue(out, map->entry(i).key, open);
+            out << ": ";
+            writeValue(out, map->entry(i).value, open);
+        }
+        out << '}';
+        open.pop_back();
     } else {
+        out << "<fn>";
+    }
+}
+
+void Interpreter::print(const Value value) {
+    if (value.isCallable()) {
         std::cout << "[ERROR] Unknown literal type.\n";
+        return;
     }
+    std::vector<const ObjMap *> open;
+    writeValue(std::cout, value, open);
+    std::cout << '\n';
 }
 
 void Interpreter::visitExpressionStmt(const Expression_Stmt &stmt) {
@@ -168,47 +259,46 @@ void Interpreter::visitExpressionStmt(const Expression_Stmt &stmt) {
         return;
     }
     stmt.m_expression->accept(*this);
-    m_result = std::nullopt;
+    m_result = Value::nil();
 }
 
-void Interpreter::visitVariableExpr(const Variable_Expr& expr) { m_result = m_environment->get(expr.m_name); }
-
-bool Interpreter::isTruthy(const OptionalLiteral &val) {
-    if (!val.has_value()) { return false; }
-    if (std::holds_alternative<bool>(val.value())) { return std::get<bool>(val.value()); }
-    return true;
+void Interpreter::visitVariableExpr(const Variable_Expr& expr) {
+    if (expr.m_depth < 0) {
+        m_result = m_globals->get(expr.m_name);
+    } else {
+        m_result = m_frames.variable(expr.m_depth, expr.m_slot);
+    }
 }
 
-bool Interpreter::isEqual(const OptionalLiteral &lhs, const OptionalLiteral &rhs) {
-    if (!lhs.has_value() || !rhs.has_value()) { return false; }
-    if (!lhs.has_value() && !rhs.has_value()) { return true; }
-    return lhs.value() == rhs.value();
-}
+bool Interpreter::isTruthy(const Value val) { return !val.isFalsey(); }
 
 void Interpreter::visitBlockStmt(const Block_Stmt &stmt) {
-    auto new_env = std::make_shared<Environment>(m_environment);
-    executeBlock(stmt.m_statements, new_env);
+    m_frames.enterScope(stmt.m_slots);
+    executeStatements(stmt.m_statements);
+    m_frames.exitScope(stmt.m_slots);
 }
 
-void Interpreter::executeBlock(const std::vector<std::shared_ptr<Stmt> > &statements, std::shared_ptr<Environment> new_env) {
-    auto previous = m_environment;
-    try {
-        m_environment = std::move(new_env);
-        for (const auto &stmt : statements) {
-            if (stmt) stmt->accept(*this);
-        }
-    } catch (...) {
-        m_environment = previous;
-        throw;
+void Interpreter::executeStatements(const StmtList statements) {
+    for (const auto &stmt : statements) {
+        if (stmt) stmt->accept(*this);
+        if (m_completion != Completion::NORMAL) { return; }
     }
-    m_environment = previous;
+}
+
+void Interpreter::executeCall(const LoxFunction &function, const std::span<const Value> arguments) {
+    const FrameStack::Caller caller =
+        m_frames.enter(m_frames.place(arguments), function.m_declaration.m_scope_size, function, function.m_upvalues);
+    executeStatements(function.m_declaration.m_statements);
+    m_frames.leave(caller);
 }
 
 void Interpreter::visitAssignExpr(const Assign_Expr &expr) {
     expr.m_value->accept(*this);
-    const OptionalLiteral value = m_result;
-    m_environment->assign(expr.m_name, value);
-    m_result = value;
+    if (expr.m_depth < 0) {
+        m_globals->assign(expr.m_name, m_result);
+    } else {
+        m_frames.variable(expr.m_depth, expr.m_slot) = m_result;
+    }
 }
 
 void Interpreter::visitIfStmt(const If_Stmt &stmt) {
@@ -220,27 +310,35 @@ void Interpreter::visitIfStmt(const If_Stmt &stmt) {
     }
 }
 
+// Runs one iteration of a loop body and reports whether the loop should keep going.
+bool Interpreter::loopBody(Stmt *body) {
+    body->accept(*this);
+    switch (m_completion) {
+        case Completion::NORMAL: return true;
+        case Completion::CONTINUE: m_completion = Completion::NORMAL; return true;
+        case Completion::BREAK: m_completion = Completion::NORMAL; return false;
+        case Completion::RETURN:
+        case Completion::TAIL_CALL: return false;
+    }
+    return false;
+}
+
 void Interpreter::visitWhileStmt(const While_Stmt &stmt) {
     while (true) {
         stmt.m_condition->accept(*this);
         if (!isTruthy(m_result)) { break; }
 
-        stmt.m_body->accept(*this);
+        if (!loopBody(stmt.m_body)) { break; }
     }
 }
 
 void Interpreter::visitForStmt(const For_Stmt &stmt) {
-    auto loop_env = std::make_shared<Environment>(m_environment);
-    auto previous = m_environment;
-    m_environment = loop_env;
+    m_frames.enterScope(stmt.m_slots);
 
     if (stmt.m_initializer) {
         stmt.m_initializer->accept(*this);
-        if (const auto var_stmt = std::dynamic_pointer_cast<Var_Stmt>(stmt.m_initializer)) {
-            const std::string name = var_stmt->m_name.lexeme();
-            OptionalLiteral value = m_environment->get(var_stmt->m_name);
-
-            if (!value.has_value() || !std::holds_alternative<double>(value.value())) {
+        if (const auto var_stmt = dynamic_cast<const Var_Stmt*>(stmt.m_initializer)) {
+            if (!m_frames.slot(var_stmt->m_slot).isNumber()) {
                 throw std::runtime_error("[ERROR] Unknown literal type for the for-loop initializer.");
             }
         }
@@ -252,44 +350,137 @@ void Interpreter::visitForStmt(const For_Stmt &stmt) {
                 break;
             }
         }
-        stmt.m_body->accept(*this);
+        if (!loopBody(stmt.m_body)) { break; }
         if (stmt.m_step) { stmt.m_step->accept(*this); }
     }
-    m_environment = previous;
+    m_frames.exitScope(stmt.m_slots);
 }
 
 void Interpreter::visitFunctionStmt(const Function_Stmt &stmt) {
-    auto function = std::make_shared<LoxFunction>(stmt, m_environment);
-    m_environment->define(stmt.m_name.lexeme(), std::move(function));
+    MemoTable *memo = m_memoizer && stmt.m_pure
+        ? &m_memoizer->table(&stmt, stmt.m_name.lexeme(), stmt.m_name.line(), stmt.m_arguments.size(),
+                             stmt.m_memo_deps)
+        : nullptr;
+    auto *closure = heap().make<LoxFunction>(stmt, memo);
+    const Value function = Value::object(closure);
+    m_temps.push_back(function);
+    for (const Capture &capture : stmt.m_captures) {
+        closure->m_upvalues.push_back(m_frames.upvalue(capture));
+    }
+    m_temps.pop_back();
+    if (stmt.m_slot < 0) {
+        m_globals->define(stmt.m_name.name(), function);
+    } else {
+        m_frames.slot(stmt.m_slot) = function;
+    }
 }
 
-void Interpreter::visitCallExpr(const Call_Expr &expr) {
-    expr.m_callee->accept(*this);
-    const OptionalLiteral callee = m_result;
-
-    std::vector<OptionalLiteral> args;
+// Pushes the callee onto m_temps and the arguments onto the value stack, where the collector
+// can see them until the call returns, and checks that the call can be made. The arguments of
+// a Lox function stay there as the parameters of its frame.
+//
+// A site calling a global by name caches the callee once it passed the checks, and while no
+// global that held a callable has been redefined or assigned since, skips the lookup and the
+// checks. A cached callee is reachable through the globals, so the pointer is still live.
+LoxCallable &Interpreter::evaluateCall(const Call_Expr &expr) {
+    // Taken before the arguments run, which may themselves redefine the callee.
+    const uint64_t version = m_globals->version();
+    const bool cached = expr.m_cached_version == version;
+    Value callee;
+    if (cached) {
+        callee = Value::object(expr.m_cached_callee);
+    } else {
+        expr.m_callee->accept(*this);
+        callee = m_result;
+    }
+    m_temps.push_back(callee);
     for (const auto &arg : expr.m_args) {
         arg->accept(*this);
-        args.emplace_back(m_result);
+        m_frames.push(m_result);
     }
+    if (cached) { return *expr.m_cached_callee; }
 
-    if (!callee.has_value() || !std::holds_alternative<std::shared_ptr<LoxCallable>>(callee.value())) {
+    if (!callee.isCallable()) {
         throw std::runtime_error("Error, attempted to call a nil value.");
     }
-
-    const auto function = std::get<std::shared_ptr<LoxCallable>>(callee.value());
-    if (args.size() != function->arity()) {
+    auto &function = *static_cast<LoxCallable*>(callee.asObj());
+    if (expr.m_args.size() != function.arity()) {
         throw std::runtime_error("Error, wrong number of arguments.");
     }
-    m_result = function->call(*this, args);
+    if (const auto *name = dynamic_cast<const Variable_Expr *>(expr.m_callee); name && name->m_depth < 0) {
+        expr.m_cached_callee = &function;
+        expr.m_cached_version = version;
+    }
+    return function;
 }
 
-void Interpreter::visitReturnStmt(const Return_Stmt &stmt) {
-    OptionalLiteral value = std::nullopt;
+void Interpreter::visitCallExpr(const Call_Expr &expr) {
+    const size_t base = m_frames.size();
+    LoxCallable &function = evaluateCall(expr);
+    const std::span<const Value> args = m_frames.top(expr.m_args.size());
+    m_result = m_profiler ? profiledCall(function, args, expr.m_paren.line()) : function.call(*this, args);
+    m_frames.truncate(base);
+    m_temps.pop_back();
+}
+
+// `return f(...)`: when f is a Lox function the call is not made here but handed to the
+// LoxFunction::call running the current function, which makes it once this function's frame is
+// gone; the profiler sees f take the current function's place. Other callees return straight
+// away, so there is nothing to save by deferring them.
+void Interpreter::tailCall(const Call_Expr &expr) {
+    const size_t base = m_frames.size();
+    LoxCallable &callee = evaluateCall(expr);
+    const std::span<const Value> args = m_frames.top(expr.m_args.size());
+    if (auto *function = dynamic_cast<LoxFunction *>(&callee)) {
+        if (m_profiler) { m_profiler->replace(profilerId(*function), expr.m_paren.line()); }
+        m_tail_function = function;
+        m_tail_arguments.assign(args.begin(), args.end());
+        m_completion = Completion::TAIL_CALL;
+    } else {
+        m_result = m_profiler ? profiledCall(callee, args, expr.m_paren.line()) : callee.call(*this, args);
+        m_completion = Completion::RETURN;
+    }
+    m_frames.truncate(base);
+    m_temps.pop_back();
+}
+
+size_t Interpreter::profilerId(const LoxCallable &callee) const {
+    if (const auto *function = dynamic_cast<const LoxFunction *>(&callee)) {
+        const Identifier &name = function->m_declaration.m_name;
+        return m_profiler->function(&function->m_declaration, name.lexeme(), name.line());
+    }
+    if (const auto *native = dynamic_cast<const NativeFunction *>(&callee)) {
+        return m_profiler->function(native, native->m_name->m_chars, 0);
+    }
+    return m_profiler->function(&callee, "<native>", 0);
+}
 
+Value Interpreter::profiledCall(LoxCallable &callee, const std::span<const Value> arguments, const size_t call_line) {
+    const size_t depth = m_profiler->depth();
+    m_profiler->enter(profilerId(callee), call_line);
+    try {
+        const Value result = callee.call(*this, arguments);
+        m_profiler->exit();
+        return result;
+    } catch (...) {
+        m_profiler->unwind(depth);
+        throw;
+    }
+}
+
+void Interpreter::visitReturnStmt(const Return_Stmt &stmt) {
+    if (stmt.m_tail_call) {
+        tailCall(*stmt.m_tail_call);
+        return;
+    }
     if (stmt.m_value) {
         stmt.m_value->accept(*this);
-        value = m_result;
+    } else {
+        m_result = Value::nil();
     }
-    throw ReturnException(value);
-}
\ No newline at end of file
+    m_completion = Completion::RETURN;
+}
+
+void Interpreter::visitBreakStmt(const Break_Stmt &) { m_completion = Completion::BREAK; }
+
+void Interpreter::visitContinueStmt(const Continue_Stmt &) { m_completion = Completion::CONTINUE; }
\ No newline at end of file
@@ -4,10 +4,65 @@
 #include "../include/scanner.hpp"
 #include "../include/parser.hpp"
 #include "../include/interpreter.hpp"
+#include "../include/resolver.hpp"
+#include "../include/optimizer.hpp"
+#include "../include/purity.hpp"
+#include "../include/vm.hpp"
+#include "../include/closure_engine.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <optional>
+
+enum class Engine { TREE, VM, CLOSURE };
 
 static bool hadError = false;
+static Engine engine = Engine::TREE;
+static int optimization_level = 1;
+static bool stream = false;
+static std::vector<std::unique_ptr<Program>> programs;
+static std::unique_ptr<Profiler> profiler;
+static const char* profile_path = "profile.folded";
+static std::unique_ptr<Memoizer> memoizer;
+
+// The engine --engine picked, with the profiler and memoizer the other flags asked for.
+class Session {
+    public:
+        Session() {
+            switch (engine) {
+                case Engine::TREE: m_interpreter = configured<Interpreter>(); break;
+                case Engine::VM: m_vm = configured<VM>(); break;
+                case Engine::CLOSURE: m_closures = configured<ClosureEngine>(); break;
+            }
+        }
 
-void run(std::string&& src, Interpreter& interpreter);
+        void interpret(const StmtList statements) const {
+            if (m_vm) {
+                m_vm->interpret(statements);
+            } else if (m_closures) {
+                m_closures->interpret(statements);
+            } else {
+                m_interpreter->interpret(statements);
+            }
+        }
+
+    private:
+        std::unique_ptr<Interpreter> m_interpreter;
+        std::unique_ptr<VM> m_vm;
+        std::unique_ptr<ClosureEngine> m_closures;
+
+        template<typename T>
+        static std::unique_ptr<T> configured() {
+            auto instance = std::make_unique<T>();
+            instance->setProfiler(profiler.get());
+            instance->setMemoizer(memoizer.get());
+            return instance;
+        }
+};
+
+void run(Source&& source, const Session& session);
+void runStream(Source&& source, const Session& session);
 
 void report(const size_t line, const char *where, const char *msg) {
     std::cerr << "[ line " << line << "] Error: "<< where << ": " << msg << '\n';
@@ -19,24 +74,22 @@ void error(const size_t line, const char* msg) {
 }
 
 void runFile(const char* path) {
-    if (std::fstream file(path, std::ios::in); !file.is_open()) {
-        std::cerr << "Failed to open file " << path << '\n';
-    } else {
-        file.seekg(0, std::ios::end);
-        const size_t size = file.tellg();
-        file.seekg(0, std::ios::beg);
-        std::string contents(size, '\0');
-        file.read(&contents[0], size);
-        file.close();
-
-        Interpreter interpreter;
-        run(std::move(contents), interpreter);
+    try {
+        Source source = Source::map(path);
+        const Session session;
+        if (stream) {
+            runStream(std::move(source), session);
+        } else {
+            run(std::move(source), session);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
     }
 }
 
 
 void runPrompt() {
-    Interpreter interpreter;
+    const Session session;
 
     std::string input;
     while (true) {
@@ -46,43 +99,149 @@ void runPrompt() {
         if (input == "quit" || input == "exit") break;
         if (input.empty()) continue; // Skip blank lines
 
-        run(std::move(input), interpreter);
+        run(Source(std::move(input)), session);
     }
 }
 
-void run(std::string&& src, Interpreter& interpreter) {
-    Scanner scanner(std::move(src));
-    std::vector<Token> tokens = scanner.scan();
+// Resolves and optimizes parsed statements in place, and finds the pure functions when
+// memoizing; false (after reporting) on an error.
+static bool prepare(std::vector<Stmt*>& statements, Arena& arena, const Optimizer& optimizer) {
+    try {
+        Resolver(arena).resolve(statements);
+        if (optimization_level > 0) {
+            optimizer.optimize(statements, arena);
+            Resolver(arena).resolve(statements);
+        }
+        if (memoizer) { PurityAnalysis(arena).analyze(statements); }
+    } catch (const std::exception& e) {
+        std::cerr << "Parser error: " << e.what() << '\n';
+        return false;
+    }
+    return true;
+}
 
-    Parser parser(std::move(tokens));
-    std::vector<std::shared_ptr<Stmt>> statements;
+static bool execute(const StmtList statements, const Session& session) {
+    try {
+        session.interpret(statements);
+    } catch (const std::exception& e) {
+        std::cerr << "Runtime error: " << e.what() << '\n';
+        return false;
+    }
+    return true;
+}
+
+void run(Source&& source, const Session& session) {
+    auto program = std::make_unique<Program>(std::move(source));
 
     try {
-        statements = parser.parse();
-        if (statements.empty()) {
-            return;
-        }
+        Scanner scanner(program->m_source.text());
+        Parser parser(scanner, program->m_arena);
+        program->m_statements = parser.parse();
+        if (parser.had_error()) { return; }
     } catch (const std::exception& e) {
         std::cerr << "Parser error: " << e.what() << '\n';
         return;
     }
+    if (program->m_statements.empty() ||
+        !prepare(program->m_statements, program->m_arena, Optimizer(optimization_level))) {
+        return;
+    }
 
+    // Functions keep pointing into the program's AST, so it stays alive for the session.
+    programs.push_back(std::move(program));
+    execute(programs.back()->m_statements, session);
+}
+
+// --stream: every top-level declaration is resolved, optimized and run as soon as it has been
+// parsed, so a long script starts executing before the rest of it is scanned, and a syntax
+// error late in the file no longer stops the code before it from running; it stops there. A declaration that
+// declared no function is released from the arena once it has run, and the literals and
+// identifiers it was first to intern are unpinned, so memory is bounded by the script's
+// functions and what its variables hold rather than by its length.
+void runStream(Source&& source, const Session& session) {
+    auto program = std::make_unique<Program>(std::move(source));
+    std::optional<Scanner> scanner;
     try {
-        interpreter.interpret(statements);
+        scanner.emplace(program->m_source.text());
     } catch (const std::exception& e) {
-        std::cerr << "Runtime error: " << e.what() << '\n';
+        std::cerr << "Parser error: " << e.what() << '\n';
+        return;
     }
+
+    Parser parser(*scanner, program->m_arena);
+    const Optimizer optimizer(optimization_level);
+    std::vector<Stmt*> statement;
+    heap().setRecording(true);
+    while (!parser.is_at_end()) {
+        const Arena::Mark mark = program->m_arena.mark();
+        const size_t functions = parser.functions_parsed();
+        statement.assign(1, parser.next_declaration());
+        if (!statement[0]) { break; }
+        if (!prepare(statement, program->m_arena, optimizer) || !execute(statement, session)) { break; }
+        if (parser.functions_parsed() == functions) {
+            program->m_arena.rewind(mark);
+            heap().unpinRecorded();
+        } else {
+            program->m_statements.push_back(statement[0]);
+            heap().forgetRecorded();
+        }
+    }
+    heap().forgetRecorded();
+    heap().setRecording(false);
+    programs.push_back(std::move(program));
 }
 
 
 int main(int argc, char *argv[]) {
-    if (argc > 2) {
-        std::cerr << "Usage: " << argv[0] << " [script]\n";
-        return 64;
-    } else if (argc == 2) {
-        runFile(argv[1]);
+    const char* script = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--engine=tree") == 0) {
+            engine = Engine::TREE;
+        } else if (std::strcmp(argv[i], "--engine=vm") == 0) {
+            engine = Engine::VM;
+        } else if (std::strcmp(argv[i], "--engine=closure") == 0) {
+            engine = Engine::CLOSURE;
+        } else if (std::strcmp(argv[i], "-O0") == 0 || std::strcmp(argv[i], "-O1") == 0 || std::strcmp(argv[i], "-O2") == 0) {
+            optimization_level = argv[i][2] - '0';
+        } else if (std::strncmp(argv[i], "--gc-growth=", 12) == 0) {
+            heap().setGrowthFactor(std::strtod(argv[i] + 12, nullptr));
+        } else if (std::strcmp(argv[i], "--stream") == 0) {
+            stream = true;
+        } else if (std::strcmp(argv[i], "--memo") == 0) {
+            memoizer = std::make_unique<Memoizer>();
+        } else if (std::strcmp(argv[i], "--gc-stress") == 0) {
+            heap().setStress(true);
+        } else if (std::strcmp(argv[i], "--profile") == 0 || std::strncmp(argv[i], "--profile=", 10) == 0) {
+            profiler = std::make_unique<Profiler>();
+            if (argv[i][9] == '=') { profile_path = argv[i] + 10; }
+        } else if (argv[i][0] != '-' && !script) {
+            script = argv[i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--engine=tree|vm|closure] [-O0|-O1|-O2] [--gc-growth=factor] [--gc-stress] [--stream] [--memo] [--profile[=folded-file]] [script]\n";
+            return 64;
+        }
+    }
+
+    if (script) {
+        runFile(script);
     } else {
         runPrompt();
     }
+
+    if (profiler) {
+        profiler->finish();
+        profiler->report(std::cerr);
+        if (std::ofstream folded(profile_path); folded.is_open()) {
+            profiler->writeFolded(folded);
+            std::cerr << "Folded stacks written to " << profile_path << '\n';
+        } else {
+            std::cerr << "Failed to write " << profile_path << '\n';
+        }
+    }
+    if (memoizer) {
+        memoizer->report(std::cerr);
+        // Unregister from the heap before static destruction tears it down.
+        memoizer.reset();
+    }
     return 0;
 }
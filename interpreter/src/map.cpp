@@ -0,0 +1,146 @@
+#include "../include/map.hpp"
+
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Bit i is set when byte i of the 16-byte group equals `byte`.
+static uint32_t matchGroup(const int8_t *group, const int8_t byte) {
+#ifdef __SSE2__
+    const __m128i control = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(control, _mm_set1_epi8(byte))));
+#else
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < 16; ++i) {
+        if (group[i] == byte) { mask |= 1u << i; }
+    }
+    return mask;
+#endif
+}
+
+// Spreads every input bit over the whole word (MurmurHash3's finaliser), so both the group
+// index and the 7-bit tag are well mixed even for FNV hashes or small integers.
+static uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb93fe53ae63bull;
+    x ^= x >> 33;
+    return x;
+}
+
+bool ObjMap::isValidKey(const Value &key) {
+    if (key.isNumber()) { return !std::isnan(key.asNumber()); }
+    return key.isBool() || key.isString();
+}
+
+uint64_t ObjMap::hash(const Value &key) {
+    if (key.isString()) {
+        return mix(key.isObjType(ObjType::STRING) ? key.asString()->m_hash : ObjString::hash(key.asChars()));
+    }
+    if (key.isNumber()) {
+        // -0 == 0, so both must hash alike.
+        const double number = key.asNumber() == 0 ? 0.0 : key.asNumber();
+        uint64_t bits;
+        std::memcpy(&bits, &number, sizeof(bits));
+        return mix(bits);
+    }
+    return mix(key.asBool() ? 1 : 2);
+}
+
+size_t ObjMap::findSlot(const Value &key, const uint64_t hash) const {
+    if (m_control.empty()) { return NOT_FOUND; }
+    const size_t groups = m_control.size() / GROUP;
+    const auto tag = static_cast<int8_t>(hash & 0x7f);
+    for (size_t group = (hash >> 7) & (groups - 1);; group = (group + 1) & (groups - 1)) {
+        const int8_t *control = m_control.data() + group * GROUP;
+        for (uint32_t matches = matchGroup(control, tag); matches != 0; matches &= matches - 1) {
+            const size_t slot = group * GROUP + std::countr_zero(matches);
+            if (m_entries[m_slots[slot]].key == key) { return slot; }
+        }
+        // The load limit guarantees an empty slot somewhere, and a key is never stored past
+        // the first group with one.
+        if (matchGroup(control, EMPTY) != 0) { return NOT_FOUND; }
+    }
+}
+
+size_t ObjMap::freeSlot(const uint64_t hash) const {
+    const size_t groups = m_control.size() / GROUP;
+    for (size_t group = (hash >> 7) & (groups - 1);; group = (group + 1) & (groups - 1)) {
+        const int8_t *control = m_control.data() + group * GROUP;
+        // Full slots have the sign bit clear, EMPTY and DELETED have it set.
+        for (uint32_t i = 0; i < GROUP; ++i) {
+            if (control[i] < 0) { return group * GROUP + i; }
+        }
+    }
+}
+
+const Value *ObjMap::find(const Value &key) const {
+    const size_t slot = findSlot(key, hash(key));
+    return slot == NOT_FOUND ? nullptr : &m_entries[m_slots[slot]].value;
+}
+
+bool ObjMap::set(const Value &key, const Value &value) {
+    const uint64_t h = hash(key);
+    if (const size_t slot = findSlot(key, h); slot != NOT_FOUND) {
+        m_entries[m_slots[slot]].value = value;
+        return false;
+    }
+
+    if ((m_entries.size() + m_deleted + 1) * 8 > m_control.size() * 7) {
+        // Mostly tombstones: clean them out in place rather than doubling.
+        const size_t capacity = m_control.empty() ? GROUP
+            : (m_entries.size() + 1) * 16 > m_control.size() * 7 ? m_control.size() * 2 : m_control.size();
+        rehash(capacity);
+    }
+    const size_t slot = freeSlot(h);
+    if (m_control[slot] == DELETED) { m_deleted--; }
+    m_control[slot] = static_cast<int8_t>(h & 0x7f);
+    m_slots[slot] = static_cast<uint32_t>(m_entries.size());
+    m_entries.push_back({key, value});
+    return true;
+}
+
+bool ObjMap::remove(const Value &key) {
+    const size_t slot = findSlot(key, hash(key));
+    if (slot == NOT_FOUND) { return false; }
+    const uint32_t index = m_slots[slot];
+    m_control[slot] = DELETED;
+    m_deleted++;
+
+    if (const size_t last = m_entries.size() - 1; index != last) {
+        m_entries[index] = m_entries[last];
+        m_slots[findSlot(m_entries[index].key, hash(m_entries[index].key))] = index;
+    }
+    m_entries.pop_back();
+    return true;
+}
+
+void ObjMap::rehash(const size_t capacity) {
+    const size_t before = byteSize();
+    m_control.assign(capacity, EMPTY);
+    m_control.shrink_to_fit();
+    m_slots.assign(capacity, 0);
+    m_slots.shrink_to_fit();
+    m_deleted = 0;
+    // Entries never outgrow the load limit, so they only reallocate here.
+    m_entries.reserve(capacity / 8 * 7);
+    for (size_t index = 0; index < m_entries.size(); ++index) {
+        const uint64_t h = hash(m_entries[index].key);
+        const size_t slot = freeSlot(h);
+        m_control[slot] = static_cast<int8_t>(h & 0x7f);
+        m_slots[slot] = static_cast<uint32_t>(index);
+    }
+    heap().resized(before, byteSize());
+}
+
+void ObjMap::trace(Heap &heap) {
+    for (const auto &[key, value] : m_entries) {
+        heap.mark(key);
+        heap.mark(value);
+    }
+}
@@ -0,0 +1,141 @@
+#include "../include/memo.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <iomanip>
+
+static constexpr size_t INITIAL_CAPACITY = 64;
+
+static uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    return x;
+}
+
+// Strings by contents, everything else by bits.
+static uint64_t hashKey(const Value &value) {
+    return value.isString() ? ObjString::hash(value.asChars()) : mix(std::bit_cast<uint64_t>(value));
+}
+
+static bool sameKey(const Value &lhs, const Value &rhs) {
+    if (lhs.isString() && rhs.isString()) { return lhs.asChars() == rhs.asChars(); }
+    return std::bit_cast<uint64_t>(lhs) == std::bit_cast<uint64_t>(rhs);
+}
+
+MemoTable::MemoTable(std::string name, const size_t line, const size_t arity)
+    : m_name(std::move(name)), m_line(line), m_arity(arity),
+      m_slots(INITIAL_CAPACITY * (arity + 1)), m_used(INITIAL_CAPACITY) {}
+
+bool MemoTable::isKey(const std::span<const Value> arguments) {
+    for (const Value &argument : arguments) {
+        if (argument.isObj() && !argument.isString()) { return false; }
+    }
+    return true;
+}
+
+// The slot holding these arguments, or the free slot where they would go.
+size_t MemoTable::slotOf(const std::span<const Value> arguments) const {
+    uint64_t hash = 0;
+    for (const Value &argument : arguments) { hash = mix(hash ^ hashKey(argument)); }
+    for (size_t slot = hash & (capacity() - 1);; slot = (slot + 1) & (capacity() - 1)) {
+        if (!m_used[slot]) { return slot; }
+        const Value *key = &m_slots[slot * (m_arity + 1)];
+        bool same = true;
+        for (size_t i = 0; i < m_arity && same; ++i) { same = sameKey(key[i], arguments[i]); }
+        if (same) { return slot; }
+    }
+}
+
+const Value *MemoTable::find(const std::span<const Value> arguments) {
+    const size_t slot = slotOf(arguments);
+    if (!m_used[slot]) {
+        m_misses++;
+        return nullptr;
+    }
+    m_hits++;
+    return &m_slots[slot * (m_arity + 1) + m_arity];
+}
+
+void MemoTable::insert(const std::span<const Value> arguments, const Value result) {
+    // Retired while the call ran.
+    if (m_retired) { return; }
+    if ((m_count + 1) * 2 > capacity()) {
+        if (capacity() >= MAX_ENTRIES * 2) {
+            std::fill(m_used.begin(), m_used.end(), false);
+            m_count = 0;
+        } else {
+            grow();
+        }
+    }
+    const size_t slot = slotOf(arguments);
+    if (!m_used[slot]) {
+        m_used[slot] = true;
+        m_count++;
+    }
+    Value *entry = &m_slots[slot * (m_arity + 1)];
+    std::copy(arguments.begin(), arguments.end(), entry);
+    entry[m_arity] = result;
+}
+
+void MemoTable::retire() {
+    m_retired = true;
+    m_count = 0;
+    m_slots.clear();
+    m_used.clear();
+}
+
+void MemoTable::grow() {
+    std::vector<Value> slots(std::move(m_slots));
+    std::vector<bool> used(std::move(m_used));
+    m_slots.assign(slots.size() * 2, Value::nil());
+    m_used.assign(used.size() * 2, false);
+    for (size_t slot = 0; slot < used.size(); ++slot) {
+        if (!used[slot]) { continue; }
+        const std::span<const Value> entry(&slots[slot * (m_arity + 1)], m_arity + 1);
+        const size_t to = slotOf(entry.first(m_arity));
+        m_used[to] = true;
+        std::copy(entry.begin(), entry.end(), &m_slots[to * (m_arity + 1)]);
+    }
+}
+
+void MemoTable::trace(Heap &heap) const {
+    for (size_t slot = 0; slot < capacity(); ++slot) {
+        if (!m_used[slot]) { continue; }
+        for (size_t i = 0; i <= m_arity; ++i) { heap.mark(m_slots[slot * (m_arity + 1) + i]); }
+    }
+}
+
+MemoTable &Memoizer::table(const void *key, const std::string_view name, const size_t line, const size_t arity,
+                           const std::span<const ObjString *const> deps) {
+    auto &table = m_tables[key];
+    if (!table) {
+        table = std::make_unique<MemoTable>(std::string(name), line, arity);
+        m_order.push_back(table.get());
+        for (const ObjString *dep : deps) { m_dependents[dep].push_back(table.get()); }
+    }
+    return *table;
+}
+
+void Memoizer::rebound(const ObjString *name) {
+    const auto it = m_dependents.find(name);
+    if (it == m_dependents.end()) { return; }
+    for (MemoTable *table : it->second) { table->retire(); }
+    m_dependents.erase(it);
+}
+
+void Memoizer::markRoots(Heap &heap) {
+    for (const auto &[key, table] : m_tables) { table->trace(heap); }
+}
+
+// One line per memoized function, in the order they were first defined.
+void Memoizer::report(std::ostream &out) const {
+    out << "\n" << std::left << std::setw(28) << "memoized function" << std::right << std::setw(12) << "hits"
+        << std::setw(12) << "misses" << std::setw(12) << "entries" << '\n';
+    for (const MemoTable *table : m_order) {
+        const std::string name = table->m_name + " (line " + std::to_string(table->m_line) + ")"
+            + (table->retired() ? " retired" : "");
+        out << std::left << std::setw(28) << name << std::right << std::setw(12) << table->m_hits
+            << std::setw(12) << table->m_misses << std::setw(12) << table->size() << '\n';
+    }
+}
@@ -0,0 +1,199 @@
+#include "../include/natives.hpp"
+
+#include "../include/array_kernels.hpp"
+#include "../include/map.hpp"
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+static double &arrayElement(const Value &array, const Value &index) {
+    auto &values = array.asArray()->m_values;
+    if (!index.isNumber() || std::floor(index.asNumber()) != index.asNumber()) {
+        throw std::runtime_error("Array index must be an integer.");
+    }
+    if (index.asNumber() < 0 || index.asNumber() >= static_cast<double>(values.size())) {
+        throw std::runtime_error("Array index out of range.");
+    }
+    return values[static_cast<size_t>(index.asNumber())];
+}
+
+static const Value &mapKey(const Value &key) {
+    if (!ObjMap::isValidKey(key)) { throw std::runtime_error("Map keys must be strings, booleans or numbers other than NaN."); }
+    return key;
+}
+
+// A key the map may keep: concatenations are interned first, so the map holds no buffers.
+static Value storedKey(const Value &key) {
+    return mapKey(key).isObjType(ObjType::CONCAT) ? Value::object(heap().string(key.asChars())) : key;
+}
+
+Value getIndex(const Value &object, const Value &index) {
+    if (object.isArray()) { return Value::number(arrayElement(object, index)); }
+    if (object.isMap()) {
+        const Value *value = object.asMap()->find(mapKey(index));
+        return value ? *value : Value::nil();
+    }
+    throw std::runtime_error("Only arrays and maps can be indexed.");
+}
+
+void setIndex(const Value &object, const Value &index, const Value &value) {
+    if (object.isArray()) {
+        if (!value.isNumber()) { throw std::runtime_error("Array elements must be numbers."); }
+        arrayElement(object, index) = value.asNumber();
+    } else if (object.isMap()) {
+        object.asMap()->set(storedKey(index), value);
+    } else {
+        throw std::runtime_error("Only arrays and maps can be indexed.");
+    }
+}
+
+static const ObjArray &arrayArgument(const std::span<const Value> arguments, const size_t index, const char *native) {
+    if (!arguments[index].isArray()) {
+        throw std::runtime_error(std::string(native) + "() expects an array.");
+    }
+    return *arguments[index].asArray();
+}
+
+static const ObjArray &nonEmptyArgument(const std::span<const Value> arguments, const char *native) {
+    const ObjArray &array = arrayArgument(arguments, 0, native);
+    if (array.m_values.empty()) { throw std::runtime_error(std::string(native) + "() of an empty array."); }
+    return array;
+}
+
+// Checks that both arguments are arrays of one length, and returns it.
+static size_t pairLength(const std::span<const Value> arguments, const char *native) {
+    const size_t length = arrayArgument(arguments, 0, native).m_values.size();
+    if (arrayArgument(arguments, 1, native).m_values.size() != length) {
+        throw std::runtime_error(std::string(native) + "() expects arrays of the same length.");
+    }
+    return length;
+}
+
+static Value newArray(const std::span<const Value> arguments) {
+    const Value length = arguments[0];
+    if (!length.isNumber() || length.asNumber() < 0 || std::floor(length.asNumber()) != length.asNumber()) {
+        throw std::runtime_error("Array() expects a non-negative integer length.");
+    }
+    return Value::object(heap().make<ObjArray>(static_cast<size_t>(length.asNumber())));
+}
+
+static Value len(const std::span<const Value> arguments) {
+    if (arguments[0].isArray()) { return Value::number(static_cast<double>(arguments[0].asArray()->m_values.size())); }
+    if (arguments[0].isString()) { return Value::number(static_cast<double>(arguments[0].asChars().size())); }
+    throw std::runtime_error("len() expects an array or a string.");
+}
+
+static Value sum(const std::span<const Value> arguments) {
+    const auto &values = arrayArgument(arguments, 0, "sum").m_values;
+    return Value::number(arrayKernels().sum(values.data(), values.size()));
+}
+
+static Value min(const std::span<const Value> arguments) {
+    const auto &values = nonEmptyArgument(arguments, "min").m_values;
+    return Value::number(arrayKernels().min(values.data(), values.size()));
+}
+
+static Value max(const std::span<const Value> arguments) {
+    const auto &values = nonEmptyArgument(arguments, "max").m_values;
+    return Value::number(arrayKernels().max(values.data(), values.size()));
+}
+
+static Value dot(const std::span<const Value> arguments) {
+    const size_t length = pairLength(arguments, "dot");
+    return Value::number(arrayKernels().dot(arguments[0].asArray()->m_values.data(),
+                                            arguments[1].asArray()->m_values.data(), length));
+}
+
+// The results below are allocated before the inputs are read again; the inputs stay reachable
+// through the caller's argument slots if that allocation collects.
+static Value scale(const std::span<const Value> arguments) {
+    const size_t length = arrayArgument(arguments, 0, "scale").m_values.size();
+    if (!arguments[1].isNumber()) { throw std::runtime_error("scale() expects a number to scale by."); }
+    auto *result = heap().make<ObjArray>(length);
+    arrayKernels().scale(arguments[0].asArray()->m_values.data(), arguments[1].asNumber(), result->m_values.data(), length);
+    return Value::object(result);
+}
+
+static Value add(const std::span<const Value> arguments) {
+    const size_t length = pairLength(arguments, "add");
+    auto *result = heap().make<ObjArray>(length);
+    arrayKernels().add(arguments[0].asArray()->m_values.data(), arguments[1].asArray()->m_values.data(),
+                       result->m_values.data(), length);
+    return Value::object(result);
+}
+
+static Value prefixSum(const std::span<const Value> arguments) {
+    const size_t length = arrayArgument(arguments, 0, "prefixSum").m_values.size();
+    auto *result = heap().make<ObjArray>(length);
+    arrayKernels().prefixSum(arguments[0].asArray()->m_values.data(), result->m_values.data(), length);
+    return Value::object(result);
+}
+
+static ObjMap &mapArgument(const std::span<const Value> arguments, const char *native) {
+    if (!arguments[0].isMap()) { throw std::runtime_error(std::string(native) + "() expects a map."); }
+    return *arguments[0].asMap();
+}
+
+// The entry that keyAt() and valueAt() refer to.
+static const ObjMap::Entry &entryArgument(const std::span<const Value> arguments, const char *native) {
+    const ObjMap &map = mapArgument(arguments, native);
+    const Value index = arguments[1];
+    if (!index.isNumber() || std::floor(index.asNumber()) != index.asNumber() || index.asNumber() < 0 ||
+        index.asNumber() >= static_cast<double>(map.size())) {
+        throw std::runtime_error(std::string(native) + "() expects an entry index below size().");
+    }
+    return map.entry(static_cast<size_t>(index.asNumber()));
+}
+
+static Value newMap(const std::span<const Value>) { return Value::object(heap().make<ObjMap>()); }
+
+static Value get(const std::span<const Value> arguments) {
+    const Value *value = mapArgument(arguments, "get").find(mapKey(arguments[1]));
+    return value ? *value : Value::nil();
+}
+
+static Value set(const std::span<const Value> arguments) {
+    mapArgument(arguments, "set");
+    arguments[0].asMap()->set(storedKey(arguments[1]), arguments[2]);
+    return arguments[2];
+}
+
+static Value has(const std::span<const Value> arguments) {
+    return Value::boolean(mapArgument(arguments, "has").find(mapKey(arguments[1])) != nullptr);
+}
+
+static Value remove(const std::span<const Value> arguments) {
+    return Value::boolean(mapArgument(arguments, "delete").remove(mapKey(arguments[1])));
+}
+
+static Value size(const std::span<const Value> arguments) {
+    return Value::number(static_cast<double>(mapArgument(arguments, "size").size()));
+}
+
+static Value keyAt(const std::span<const Value> arguments) { return entryArgument(arguments, "keyAt").key; }
+static Value valueAt(const std::span<const Value> arguments) { return entryArgument(arguments, "valueAt").value; }
+
+const std::vector<NativeFunction *> &natives() {
+    static const std::vector<NativeFunction *> functions = [] {
+        struct Spec {
+            const char *name;
+            size_t arity;
+            NativeFunction::Function function;
+        };
+        static constexpr Spec specs[] = {
+            {"Array", 1, newArray}, {"len", 1, len}, {"sum", 1, sum}, {"min", 1, min}, {"max", 1, max},
+            {"dot", 2, dot}, {"scale", 2, scale}, {"add", 2, add}, {"prefixSum", 1, prefixSum},
+            {"Map", 0, newMap}, {"get", 2, get}, {"set", 3, set}, {"has", 2, has}, {"delete", 2, remove},
+            {"size", 1, size}, {"keyAt", 2, keyAt}, {"valueAt", 2, valueAt},
+        };
+        std::vector<NativeFunction *> result;
+        for (const auto &[name, arity, function] : specs) {
+            auto *native = heap().make<NativeFunction>(heap().constant(name), arity, function);
+            native->m_pinned = true;
+            result.push_back(native);
+        }
+        return result;
+    }();
+    return functions;
+}
@@ -0,0 +1,91 @@
+#include "../include/object.hpp"
+#include "../include/value.hpp"
+
+#include <cmath>
+#include <stdexcept>
+
+// Results up to this long are interned like any other string; beyond it concatenation
+// switches to shared buffers, where appends are amortised O(1).
+static constexpr size_t MAX_INTERNED_CONCAT = 32;
+
+void Heap::mark(const Value &value) {
+    if (value.isObj()) { mark(value.asObj()); }
+}
+
+void Heap::collect() {
+    for (GcRoots *roots : m_roots) {
+        roots->markRoots(*this);
+    }
+    while (!m_gray.empty()) {
+        Obj *object = m_gray.back();
+        m_gray.pop_back();
+        object->trace(*this);
+    }
+    sweep();
+
+    m_next_gc = std::max(static_cast<size_t>(static_cast<double>(m_bytes_allocated) * m_growth_factor),
+                         INITIAL_THRESHOLD);
+    m_collections++;
+}
+
+void Heap::sweep() {
+    Obj **link = &m_objects;
+    while (Obj *object = *link) {
+        if (object->m_marked || object->m_pinned) {
+            object->m_marked = false;
+            link = &object->m_next;
+            continue;
+        }
+        *link = object->m_next;
+        if (object->m_type == ObjType::STRING) {
+            m_strings.erase(static_cast<ObjString *>(object));
+        }
+        m_bytes_allocated -= object->byteSize();
+        delete object;
+    }
+}
+
+Obj *Heap::concat(const Value &left, const Value &right) {
+    const std::string_view head = left.asChars();
+    const std::string_view tail = right.asChars();
+    const size_t length = head.size() + tail.size();
+
+    if (left.isObjType(ObjType::CONCAT)) {
+        const auto *prefix = static_cast<const ObjConcat *>(left.asObj());
+        if (prefix->m_length == prefix->m_buffer->size()) {
+            std::shared_ptr<std::string> buffer = prefix->m_buffer;
+            if (right.isObjType(ObjType::CONCAT) && static_cast<const ObjConcat *>(right.asObj())->m_buffer == buffer) {
+                // `s + s`: the tail lives in the buffer being grown.
+                buffer->append(std::string(tail));
+            } else {
+                buffer->append(tail);
+            }
+            return make<ObjConcat>(std::move(buffer), length, tail.size());
+        }
+    }
+
+    if (length <= MAX_INTERNED_CONCAT) {
+        std::string chars;
+        chars.reserve(length);
+        chars.append(head).append(tail);
+        return string(std::move(chars));
+    }
+    auto buffer = std::make_shared<std::string>();
+    // Leave room for the appends that usually follow.
+    buffer->reserve(length * 2);
+    buffer->append(head).append(tail);
+    return make<ObjConcat>(std::move(buffer), length, length);
+}
+
+ObjString *Heap::repeat(const std::string_view chars, const double times) {
+    const double count = times > 0 ? std::ceil(times) : 0;
+    std::string result;
+    if (!chars.empty() && count > 0) {
+        if (count > static_cast<double>(result.max_size() / chars.size())) {
+            throw std::runtime_error("Repeated string is too long.");
+        }
+        result.reserve(chars.size() * static_cast<size_t>(count));
+        for (size_t i = 0; i < static_cast<size_t>(count); i++) { result.append(chars); }
+    }
+    return string(std::move(result));
+}
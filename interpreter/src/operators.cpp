@@ -0,0 +1,68 @@
+#include "../include/operators.hpp"
+
+#include <stdexcept>
+#include <string_view>
+
+static void checkNotNil(const Value left, const Value right) {
+    if (left.isNil() || right.isNil()) { throw std::runtime_error("Operands must not be nil."); }
+}
+
+Value addOperands(const Value left, const Value right) {
+    checkNotNil(left, right);
+    if (left.isString() && right.isString()) { return Value::object(heap().concat(left, right)); }
+    throw std::runtime_error("Operands must either be numbers or two strings.");
+}
+
+Value subtractOperands(const Value left, const Value right) {
+    checkNotNil(left, right);
+    throw std::runtime_error("Operands must not be numbers.");
+}
+
+Value multiplyOperands(const Value left, const Value right) {
+    checkNotNil(left, right);
+    if (left.isString() && right.isNumber()) { return Value::object(heap().repeat(left.asChars(), right.asNumber())); }
+    if (left.isNumber() && right.isString()) { return Value::object(heap().repeat(right.asChars(), left.asNumber())); }
+    throw std::runtime_error("Unsupported operands for \'*\'");
+}
+
+Value divideOperands(const Value left, const Value right) {
+    checkNotNil(left, right);
+    if (left.isNumber() && right.isNumber()) { throw std::runtime_error("Error! Division by zero."); }
+    throw std::runtime_error("Operands must not be numbers.");
+}
+
+Value compareOperands(const TokenType type, const Value left, const Value right) {
+    checkNotNil(left, right);
+    if (!left.isString() || !right.isString()) {
+        throw std::runtime_error("Operands for comparison must either be two numbers or two strings.");
+    }
+    const std::string_view l = left.asChars();
+    const std::string_view r = right.asChars();
+    switch (type) {
+        case TokenType::LESS: return Value::boolean(l < r);
+        case TokenType::LESS_EQUAL: return Value::boolean(l <= r);
+        case TokenType::GREATER: return Value::boolean(l > r);
+        default: return Value::boolean(l >= r);
+    }
+}
+
+Value equalOperands(const Value left, const Value right, const bool equal) {
+    checkNotNil(left, right);
+    return Value::boolean((left == right) == equal);
+}
+
+BinaryOperator binaryOperator(const TokenType type) {
+    switch (type) {
+        case TokenType::PLUS: return binaryAdd;
+        case TokenType::MINUS: return binarySubtract;
+        case TokenType::STAR: return binaryMultiply;
+        case TokenType::SLASH: return binaryDivide;
+        case TokenType::LESS: return binaryLess;
+        case TokenType::LESS_EQUAL: return binaryLessEqual;
+        case TokenType::GREATER: return binaryGreater;
+        case TokenType::GREATER_EQUAL: return binaryGreaterEqual;
+        case TokenType::EQUAL_EQUAL: return binaryEqual;
+        case TokenType::BANG_EQUAL: return binaryNotEqual;
+        default: return nullptr;
+    }
+}
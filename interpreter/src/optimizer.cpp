@@ -0,0 +1,373 @@
+#include "../include/optimizer.hpp"
+
+#include <cmath>
+
+void Pass::run(std::vector<Stmt *> &statements, Arena &arena) {
+    m_arena = &arena;
+    std::vector<Stmt *> result;
+    result.reserve(statements.size());
+    for (Stmt *stmt : statements) {
+        if (Stmt *rewritten = rewrite(stmt)) { result.push_back(rewritten); }
+    }
+    statements = std::move(result);
+}
+
+Expr *Pass::rewrite(Expr *expr) {
+    if (!expr) { return nullptr; }
+    m_expr = expr;
+    expr->accept(*this);
+    return simplify(m_expr);
+}
+
+Stmt *Pass::rewrite(Stmt *stmt) {
+    if (!stmt) { return nullptr; }
+    m_stmt = stmt;
+    stmt->accept(*this);
+    return simplify(m_stmt);
+}
+
+Stmt *Pass::rewriteBody(Stmt *stmt) {
+    Stmt *rewritten = rewrite(stmt);
+    return rewritten ? rewritten : m_arena->make<Block_Stmt>(StmtList{});
+}
+
+StmtList Pass::rewrite(const StmtList statements) {
+    std::vector<Stmt *> result;
+    bool changed = false;
+    for (Stmt *stmt : statements) {
+        Stmt *rewritten = rewrite(stmt);
+        changed |= rewritten != stmt;
+        if (rewritten) { result.push_back(rewritten); }
+    }
+    return changed ? m_arena->array(result) : statements;
+}
+
+ExprList Pass::rewrite(const ExprList exprs) {
+    std::vector<Expr *> result;
+    bool changed = false;
+    for (Expr *expr : exprs) {
+        result.push_back(rewrite(expr));
+        changed |= result.back() != expr;
+    }
+    return changed ? m_arena->array(result) : exprs;
+}
+
+void Pass::visitBinaryExpr(const Binary_Expr &expr) {
+    Expr *const original = m_expr;
+    Expr *left = rewrite(expr.m_left);
+    Expr *right = rewrite(expr.m_right);
+    m_expr = left == expr.m_left && right == expr.m_right
+        ? original : m_arena->make<Binary_Expr>(left, expr.m_op, right);
+}
+
+void Pass::visitGroupingExpr(const Grouping_Expr &expr) {
+    Expr *const original = m_expr;
+    const ExprList exprs = rewrite(expr.m_exprs);
+    m_expr = exprs.data() == expr.m_exprs.data() ? original : m_arena->make<Grouping_Expr>(exprs);
+}
+
+void Pass::visitLiteralExpr(const Literal_Expr &) {}
+
+void Pass::visitUnaryExpr(const Unary_Expr &expr) {
+    Expr *const original = m_expr;
+    Expr *operand = rewrite(expr.m_operand);
+    m_expr = operand == expr.m_operand ? original : m_arena->make<Unary_Expr>(operand, expr.m_op);
+}
+
+void Pass::visitVariableExpr(const Variable_Expr &) {}
+
+void Pass::visitAssignExpr(const Assign_Expr &expr) {
+    Expr *const original = m_expr;
+    Expr *value = rewrite(expr.m_value);
+    m_expr = value == expr.m_value ? original : m_arena->make<Assign_Expr>(expr.m_name, value);
+}
+
+void Pass::visitCallExpr(const Call_Expr &expr) {
+    Expr *const original = m_expr;
+    Expr *callee = rewrite(expr.m_callee);
+    const ExprList args = rewrite(expr.m_args);
+    m_expr = callee == expr.m_callee && args.data() == expr.m_args.data()
+        ? original : m_arena->make<Call_Expr>(callee, expr.m_paren, args);
+}
+
+void Pass::visitArrayExpr(const Array_Expr &expr) {
+    Expr *const original = m_expr;
+    const ExprList elements = rewrite(expr.m_elements);
+    m_expr = elements.data() == expr.m_elements.data() ? original : m_arena->make<Array_Expr>(expr.m_bracket, elements);
+}
+
+void Pass::visitIndexExpr(const Index_Expr &expr) {
+    Expr *const original = m_expr;
+    Expr *object = rewrite(expr.m_object);
+    Expr *index = rewrite(expr.m_index);
+    m_expr = object == expr.m_object && index == expr.m_index
+        ? original : m_arena->make<Index_Expr>(object, expr.m_bracket, index);
+}
+
+void Pass::visitIndexSetExpr(const IndexSet_Expr &expr) {
+    Expr *const original = m_expr;
+    Expr *object = rewrite(expr.m_object);
+    Expr *index = rewrite(expr.m_index);
+    Expr *value = rewrite(expr.m_value);
+    m_expr = object == expr.m_object && index == expr.m_index && value == expr.m_value
+        ? original : m_arena->make<IndexSet_Expr>(object, expr.m_bracket, index, value);
+}
+
+void Pass::visitExpressionStmt(const Expression_Stmt &stmt) {
+    Stmt *const original = m_stmt;
+    Expr *expression = rewrite(stmt.m_expression);
+    m_stmt = expression == stmt.m_expression ? original : m_arena->make<Expression_Stmt>(expression);
+}
+
+void Pass::visitPrintStmt(const Print_Stmt &stmt) {
+    Stmt *const original = m_stmt;
+    Expr *expression = rewrite(stmt.m_expression);
+    m_stmt = expression == stmt.m_expression ? original : m_arena->make<Print_Stmt>(expression);
+}
+
+void Pass::visitVarStmt(const Var_Stmt &stmt) {
+    Stmt *const original = m_stmt;
+    Expr *value = rewrite(stmt.m_value);
+    m_stmt = value == stmt.m_value ? original : m_arena->make<Var_Stmt>(stmt.m_name, value);
+}
+
+void Pass::visitBlockStmt(const Block_Stmt &stmt) {
+    Stmt *const original = m_stmt;
+    const StmtList statements = rewrite(stmt.m_statements);
+    m_stmt = statements.data() == stmt.m_statements.data() ? original : m_arena->make<Block_Stmt>(statements);
+}
+
+void Pass::visitIfStmt(const If_Stmt &stmt) {
+    Stmt *const original = m_stmt;
+    Expr *condition = rewrite(stmt.m_condition);
+    Stmt *then_branch = rewriteBody(stmt.m_then_branch);
+    Stmt *else_branch = rewrite(stmt.m_else_branch);
+    m_stmt = condition == stmt.m_condition && then_branch == stmt.m_then_branch && else_branch == stmt.m_else_branch
+        ? original : m_arena->make<If_Stmt>(condition, then_branch, else_branch);
+}
+
+void Pass::visitWhileStmt(const While_Stmt &stmt) {
+    Stmt *const original = m_stmt;
+    Expr *condition = rewrite(stmt.m_condition);
+    Stmt *body = rewriteBody(stmt.m_body);
+    m_stmt = condition == stmt.m_condition && body == stmt.m_body
+        ? original : m_arena->make<While_Stmt>(condition, body);
+}
+
+void Pass::visitForStmt(const For_Stmt &stmt) {
+    Stmt *const original = m_stmt;
+    Stmt *initializer = rewrite(stmt.m_initializer);
+    Expr *condition = rewrite(stmt.m_condition);
+    Expr *step = rewrite(stmt.m_step);
+    Stmt *body = rewriteBody(stmt.m_body);
+    m_stmt = initializer == stmt.m_initializer && condition == stmt.m_condition && step == stmt.m_step &&
+             body == stmt.m_body
+        ? original : m_arena->make<For_Stmt>(initializer, condition, step, body);
+}
+
+void Pass::visitFunctionStmt(const Function_Stmt &stmt) {
+    Stmt *const original = m_stmt;
+    const StmtList statements = rewrite(stmt.m_statements);
+    m_stmt = statements.data() == stmt.m_statements.data()
+        ? original : m_arena->make<Function_Stmt>(stmt.m_name, stmt.m_arguments, statements);
+}
+
+void Pass::visitReturnStmt(const Return_Stmt &stmt) {
+    Stmt *const original = m_stmt;
+    Expr *value = rewrite(stmt.m_value);
+    m_stmt = value == stmt.m_value ? original : m_arena->make<Return_Stmt>(stmt.m_keyword, value);
+}
+
+void Pass::visitBreakStmt(const Break_Stmt &) {}
+
+void Pass::visitContinueStmt(const Continue_Stmt &) {}
+
+// Longest string a fold may produce; longer repeats are left for runtime, if they ever run.
+static constexpr size_t MAX_FOLDED_STRING = 4096;
+
+// Mirrors Interpreter::visitBinaryExpr, but reports failure instead of throwing.
+static bool foldBinary(const TokenType op, const Value left, const Value right, Value &result) {
+    if (left.isNil() || right.isNil()) { return false; }
+    const bool numbers = left.isNumber() && right.isNumber();
+    const bool strings = left.isString() && right.isString();
+
+    switch (op) {
+        case TokenType::EQUAL_EQUAL: result = Value::boolean(left == right); return true;
+        case TokenType::BANG_EQUAL: result = Value::boolean(!(left == right)); return true;
+        case TokenType::PLUS:
+            if (numbers) {
+                result = Value::number(left.asNumber() + right.asNumber());
+            } else if (strings) {
+                result = Value::object(heap().constant(left.asString()->m_chars + right.asString()->m_chars));
+            } else {
+                return false;
+            }
+            return true;
+        case TokenType::STAR: {
+            if (numbers) {
+                result = Value::number(left.asNumber() * right.asNumber());
+                return true;
+            }
+            const Value text = left.isString() ? left : right;
+            const Value times = left.isString() ? right : left;
+            if (!text.isString() || !times.isNumber()) { return false; }
+            // Counted like Heap::repeat, and sized before any copying.
+            const std::string &chars = text.asString()->m_chars;
+            const double count = times.asNumber() > 0 ? std::ceil(times.asNumber()) : 0;
+            if (chars.empty() || count == 0) {
+                result = Value::object(heap().constant(""));
+                return true;
+            }
+            if (count > static_cast<double>(MAX_FOLDED_STRING / chars.size())) { return false; }
+            std::string repeated;
+            repeated.reserve(chars.size() * static_cast<size_t>(count));
+            for (size_t i = 0; i < static_cast<size_t>(count); i++) { repeated.append(chars); }
+            result = Value::object(heap().constant(repeated));
+            return true;
+        }
+        case TokenType::MINUS:
+            if (!numbers) { return false; }
+            result = Value::number(left.asNumber() - right.asNumber());
+            return true;
+        case TokenType::SLASH:
+            if (!numbers || right.asNumber() == 0.0) { return false; }
+            result = Value::number(left.asNumber() / right.asNumber());
+            return true;
+        case TokenType::GREATER:
+        case TokenType::GREATER_EQUAL:
+        case TokenType::LESS:
+        case TokenType::LESS_EQUAL: {
+            int order;
+            if (numbers) {
+                const double l = left.asNumber(), r = right.asNumber();
+                order = l < r ? -1 : (l > r ? 1 : (l == r ? 0 : 2));
+            } else if (strings) {
+                const int cmp = left.asString()->m_chars.compare(right.asString()->m_chars);
+                order = cmp < 0 ? -1 : (cmp > 0 ? 1 : 0);
+            } else {
+                return false;
+            }
+            if (op == TokenType::GREATER) result = Value::boolean(order == 1);
+            else if (op == TokenType::GREATER_EQUAL) result = Value::boolean(order == 1 || order == 0);
+            else if (op == TokenType::LESS) result = Value::boolean(order == -1);
+            else result = Value::boolean(order == -1 || order == 0);
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+Expr *ConstantFolding::simplify(Expr *expr) {
+    if (const auto binary = dynamic_cast<const Binary_Expr *>(expr)) {
+        const auto left = dynamic_cast<const Literal_Expr *>(binary->m_left);
+        const auto right = dynamic_cast<const Literal_Expr *>(binary->m_right);
+        if (Value result; left && right && foldBinary(binary->m_op.type(), left->m_value, right->m_value, result)) {
+            return m_arena->make<Literal_Expr>(result);
+        }
+    } else if (const auto unary = dynamic_cast<const Unary_Expr *>(expr)) {
+        if (const auto operand = dynamic_cast<const Literal_Expr *>(unary->m_operand)) {
+            const Value value = operand->m_value;
+            if (unary->m_op.type() == TokenType::MINUS && value.isNumber()) {
+                return m_arena->make<Literal_Expr>(Value::number(-value.asNumber()));
+            }
+            if (unary->m_op.type() == TokenType::BANG) {
+                return m_arena->make<Literal_Expr>(Value::boolean(value.isFalsey()));
+            }
+        }
+    } else if (const auto grouping = dynamic_cast<const Grouping_Expr *>(expr)) {
+        if (grouping->m_exprs.empty()) {
+            return m_arena->make<Literal_Expr>(Value::nil());
+        }
+        if (dynamic_cast<const Literal_Expr *>(grouping->m_exprs.front())) {
+            return grouping->m_exprs.front();
+        }
+    }
+    return expr;
+}
+
+Stmt *DeadBranchElimination::simplify(Stmt *stmt) {
+    if (const auto if_stmt = dynamic_cast<const If_Stmt *>(stmt)) {
+        if (const auto condition = dynamic_cast<const Literal_Expr *>(if_stmt->m_condition)) {
+            return condition->m_value.isFalsey() ? if_stmt->m_else_branch : if_stmt->m_then_branch;
+        }
+    } else if (const auto while_stmt = dynamic_cast<const While_Stmt *>(stmt)) {
+        if (const auto condition = dynamic_cast<const Literal_Expr *>(while_stmt->m_condition)) {
+            if (condition->m_value.isFalsey()) { return nullptr; }
+        }
+    }
+    return stmt;
+}
+
+// True if evaluating `expr` either yields a number or raises a runtime error.
+static bool isNumeric(const Expr *expr) {
+    if (const auto literal = dynamic_cast<const Literal_Expr *>(expr)) {
+        return literal->m_value.isNumber();
+    }
+    if (const auto unary = dynamic_cast<const Unary_Expr *>(expr)) {
+        const TokenType op = unary->m_op.type();
+        return op == TokenType::MINUS || op == TokenType::INCREMENT || op == TokenType::DECREMENT;
+    }
+    if (const auto binary = dynamic_cast<const Binary_Expr *>(expr)) {
+        switch (binary->m_op.type()) {
+            case TokenType::MINUS:
+            case TokenType::SLASH:
+                return true;
+            case TokenType::PLUS:
+            case TokenType::STAR:
+                return isNumeric(binary->m_left) && isNumeric(binary->m_right);
+            default:
+                return false;
+        }
+    }
+    if (const auto grouping = dynamic_cast<const Grouping_Expr *>(expr)) {
+        return !grouping->m_exprs.empty() && isNumeric(grouping->m_exprs.front());
+    }
+    return false;
+}
+
+static bool isNumber(const Expr *expr, const double number) {
+    const auto literal = dynamic_cast<const Literal_Expr *>(expr);
+    return literal && literal->m_value.isNumber() && literal->m_value.asNumber() == number &&
+           !std::signbit(literal->m_value.asNumber());
+}
+
+Expr *AlgebraicSimplification::simplify(Expr *expr) {
+    if (const auto binary = dynamic_cast<const Binary_Expr *>(expr)) {
+        Expr *left = binary->m_left;
+        Expr *right = binary->m_right;
+        switch (binary->m_op.type()) {
+            case TokenType::STAR:
+                if (isNumber(right, 1) && isNumeric(left)) { return left; }
+                if (isNumber(left, 1) && isNumeric(right)) { return right; }
+                break;
+            case TokenType::SLASH:
+                if (isNumber(right, 1) && isNumeric(left)) { return left; }
+                break;
+            case TokenType::MINUS:
+                // Only +0: e - (-0) is e + 0, which turns -0 into 0. For the same reason e + 0 is kept.
+                if (isNumber(right, 0) && isNumeric(left)) { return left; }
+                break;
+            default:
+                break;
+        }
+    } else if (const auto unary = dynamic_cast<const Unary_Expr *>(expr); unary && unary->m_op.type() == TokenType::MINUS) {
+        const auto inner = dynamic_cast<const Unary_Expr *>(unary->m_operand);
+        if (inner && inner->m_op.type() == TokenType::MINUS && isNumeric(inner->m_operand)) {
+            return inner->m_operand;
+        }
+    }
+    return expr;
+}
+
+Optimizer::Optimizer(const int level) {
+    if (level >= 1) { m_passes.push_back(std::make_unique<ConstantFolding>()); }
+    if (level >= 2) { m_passes.push_back(std::make_unique<AlgebraicSimplification>()); }
+    if (level >= 1) { m_passes.push_back(std::make_unique<DeadBranchElimination>()); }
+}
+
+void Optimizer::optimize(std::vector<Stmt *> &statements, Arena &arena) const {
+    for (const auto &pass : m_passes) {
+        pass->run(statements, arena);
+    }
+}
@@ -1,5 +1,6 @@
 #include "../include/parser.hpp"
 
+#include <charconv>
 #include <functional>
 
 #include "../include/expr.hpp"
@@ -8,8 +9,13 @@
 #include <stdexcept>
 #include <vector>
 
-std::vector<std::shared_ptr<Stmt>> Parser::parse() {
-    std::vector<std::shared_ptr<Stmt>> statements;
+Parser::Parser(Scanner& scanner, Arena& arena)
+    : m_scanner(scanner), m_source(scanner.source()), m_arena(arena) {
+    m_ring[0] = m_scanner.next();
+}
+
+std::vector<Stmt*> Parser::parse() {
+    std::vector<Stmt*> statements;
     while (!is_at_end()) {
         auto stmt = declaration();
         if (stmt) {
@@ -25,55 +31,56 @@ bool Parser::match(Types... types) {
     return ((check(types) ? (advance(), true) : false) || ...);
 }
 
-std::shared_ptr<Stmt> Parser::declaration() {
+Stmt* Parser::declaration() {
     try {
         if (match(TokenType::FUN)) return function_declaration();
         if (match(TokenType::VAR)) return var_declaration();
         return statement();
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
+        m_had_error = true;
         synchronize();
         return nullptr;
     }
 }
 
-std::shared_ptr<Stmt> Parser::var_declaration() {
-    Token name = consume(TokenType::IDENTIFIER, "Expected a variable name.");
-    std::shared_ptr<Expr> initializer = nullptr;
+Stmt* Parser::var_declaration() {
+    const Identifier name = identifier(consume(TokenType::IDENTIFIER, "Expected a variable name."));
+    Expr* initializer = nullptr;
 
     if (match(TokenType::EQUAL)) {
         initializer = expression();
     }
     consume(TokenType::SEMICOLON, "Expected ';' after variable declaration.");
-    return std::make_shared<Var_Stmt>(name, initializer);
+    return m_arena.make<Var_Stmt>(name, initializer);
 }
 
-std::shared_ptr<Stmt> Parser::if_statement() {
+Stmt* Parser::if_statement() {
     consume(TokenType::LEFT_PAREN, "Expected '(' after if statement.");
     auto condition = expression();
     consume(TokenType::RIGHT_PAREN, "Expected ')' after if statement.");
 
     auto then_branch = statement();
-    std::shared_ptr<Stmt> else_branch = nullptr;
+    Stmt* else_branch = nullptr;
 
     if (match(TokenType::ELSE)) {
         else_branch = statement();
     }
-    return std::make_shared<If_Stmt>(condition, then_branch, else_branch);
+    return m_arena.make<If_Stmt>(condition, then_branch, else_branch);
 }
 
-std::shared_ptr<Stmt> Parser::while_statement() {
+Stmt* Parser::while_statement() {
     consume(TokenType::LEFT_PAREN, "Expected '(' after while statement.");
     auto condition = expression();
     consume(TokenType::RIGHT_PAREN, "Expected ')' after while statement.");
     auto body = statement();
-    return std::make_shared<While_Stmt>(condition, body);
+    return m_arena.make<While_Stmt>(condition, body);
 }
 
-std::shared_ptr<Stmt> Parser::for_statement() {
+Stmt* Parser::for_statement() {
     consume(TokenType::LEFT_PAREN, "Expected '(' after for statement.");
 
-    std::shared_ptr<Stmt> initializer;
+    Stmt* initializer;
     if (match(TokenType::SEMICOLON)) {
         initializer = nullptr;
     } else if (match(TokenType::VAR)) {
@@ -82,67 +89,70 @@ std::shared_ptr<Stmt> Parser::for_statement() {
         initializer = expression_statement();
     }
 
-    std::shared_ptr<Expr> condition = nullptr;
+    Expr* condition = nullptr;
     if (!check(TokenType::SEMICOLON)) {
         condition = expression();
     }
     consume(TokenType::SEMICOLON, "Expected ';' after loop condition.");
 
 
-    std::shared_ptr<Expr> step = nullptr;
+    Expr* step = nullptr;
     if (!check(TokenType::RIGHT_PAREN)) {
         step = expression();
     }
     consume(TokenType::RIGHT_PAREN, "Expected ')' after loop condition.");
-    std::shared_ptr<Stmt> body = statement();
-    return std::make_shared<For_Stmt>(initializer, condition, step, body);
+    Stmt* body = statement();
+    return m_arena.make<For_Stmt>(initializer, condition, step, body);
 }
 
-std::shared_ptr<Stmt> Parser::statement() {
+Stmt* Parser::statement() {
     if (match(TokenType::PRINT)) { return print_statement(); }
     if (match(TokenType::IF)) { return if_statement(); }
     if (match(TokenType::WHILE)) { return while_statement(); }
     if (match(TokenType::FOR)) { return for_statement(); }
-    if (match(TokenType::LEFT_BRACE)) { return std::make_shared<Block_Stmt>(block_statement()); }
+    if (match(TokenType::LEFT_BRACE)) { return m_arena.make<Block_Stmt>(block_statement()); }
     if (match(TokenType::RETURN)) { return return_statement(); }
+    if (match(TokenType::BREAK, TokenType::CONTINUE)) { return jump_statement(); }
     return expression_statement();
 }
 
-std::shared_ptr<Stmt> Parser::print_statement() {
-    std::shared_ptr<Expr> value = expression();
+Stmt* Parser::print_statement() {
+    Expr* value = expression();
     consume(TokenType::SEMICOLON, "Expected ';' after statement.");
-    return std::make_shared<Print_Stmt>(value);
+    return m_arena.make<Print_Stmt>(value);
 }
 
-std::shared_ptr<Stmt> Parser::expression_statement() {
-    std::shared_ptr<Expr> expr = expression();
+Stmt* Parser::expression_statement() {
+    Expr* expr = expression();
     consume(TokenType::SEMICOLON, "Expected ';' after expression.");
-    return std::make_shared<Expression_Stmt>(expr);
+    return m_arena.make<Expression_Stmt>(expr);
 }
 
-std::shared_ptr<Stmt> Parser::function_declaration() {
-    Token name = consume(TokenType::IDENTIFIER, "Expected a function name.");
+Stmt* Parser::function_declaration() {
+    m_functions++;
+    const Identifier name = identifier(consume(TokenType::IDENTIFIER, "Expected a function name."));
     consume(TokenType::LEFT_PAREN, "Expected '(' after function name declaration.");
 
-    std::vector<Token> parameters;
+    std::vector<Identifier> parameters;
     if (!check(TokenType::RIGHT_PAREN)) {
         do {
-            if (parameters.size() >= 255) {
-                std::cerr << "Too many arguments!" << std::endl;
+            if (parameters.size() >= MAX_ARGUMENTS) {
+                throw std::runtime_error("Line " + std::to_string(peek().line()) + ": Can't have more than " +
+                                         std::to_string(MAX_ARGUMENTS) + " parameters.");
             }
-            parameters.push_back(consume(TokenType::IDENTIFIER, "Expected parameter name"));
+            parameters.push_back(identifier(consume(TokenType::IDENTIFIER, "Expected parameter name")));
         } while (match(TokenType::COMMA));
     }
     consume(TokenType::RIGHT_PAREN, "Expected ')' after function declaration.");
     consume(TokenType::LEFT_BRACE, "Expected '{' after function declaration.");
     auto body = block_statement();
 
-    return std::make_shared<Function_Stmt>(name, parameters, body);
+    return m_arena.make<Function_Stmt>(name, m_arena.array(parameters), body);
 }
 
 
-std::vector<std::shared_ptr<Stmt>>Parser::block_statement() {
-    std::vector<std::shared_ptr<Stmt>> statements;
+StmtList Parser::block_statement() {
+    std::vector<Stmt*> statements;
 
     while (!check(TokenType::RIGHT_BRACE) && !is_at_end()) {
         auto stmt = declaration();
@@ -151,18 +161,28 @@ std::vector<std::shared_ptr<Stmt>>Parser::block_statement() {
         }
     }
     consume(TokenType::RIGHT_BRACE, "Expected '}' after block.");
-    return statements;
+    return m_arena.array(statements);
 }
 
-std::shared_ptr<Stmt>Parser::return_statement() {
+Stmt*Parser::return_statement() {
     Token keyword = previous();
-    std::shared_ptr<Expr> value = nullptr;
+    Expr* value = nullptr;
 
     if (!check(TokenType::SEMICOLON)) {
         value = expression();
     }
     consume(TokenType::SEMICOLON, "Expected ';' after return statement.");
-    return std::make_shared<Return_Stmt>(keyword, value);
+    return m_arena.make<Return_Stmt>(keyword, value);
+}
+
+Stmt* Parser::jump_statement() {
+    Token keyword = previous();
+    if (keyword.type() == TokenType::BREAK) {
+        consume(TokenType::SEMICOLON, "Expected ';' after break statement.");
+        return m_arena.make<Break_Stmt>(keyword);
+    }
+    consume(TokenType::SEMICOLON, "Expected ';' after continue statement.");
+    return m_arena.make<Continue_Stmt>(keyword);
 }
 
 void Parser::synchronize() {
@@ -187,19 +207,22 @@ void Parser::synchronize() {
     }
 }
 
-std::shared_ptr<Expr> Parser::expression() {
+Expr* Parser::expression() {
     return assignment();
 }
 
-std::shared_ptr<Expr> Parser::assignment() {
+Expr* Parser::assignment() {
     auto expr = equality();
 
     if (match(TokenType::EQUAL)) {
         Token equals = previous();
         auto value = assignment();  // right-associative
 
-        if (auto var = std::dynamic_pointer_cast<Variable_Expr>(expr)) {
-            return std::make_shared<Assign_Expr>(var->m_name, value);
+        if (const auto var = dynamic_cast<Variable_Expr*>(expr)) {
+            return m_arena.make<Assign_Expr>(var->m_name, value);
+        }
+        if (const auto index = dynamic_cast<Index_Expr*>(expr)) {
+            return m_arena.make<IndexSet_Expr>(index->m_object, index->m_bracket, index->m_index, value);
         }
 
         throw std::runtime_error("Invalid assignment target.");
@@ -208,88 +231,109 @@ std::shared_ptr<Expr> Parser::assignment() {
     return expr;
 }
 
-std::shared_ptr<Expr> Parser::equality() {
+Expr* Parser::equality() {
     auto expr = comparison();
     while (match(TokenType::BANG_EQUAL, TokenType::EQUAL_EQUAL)) {
         Token op = previous();
         auto right = comparison();
-        expr = std::make_shared<Binary_Expr>(expr, op, right);
+        expr = m_arena.make<Binary_Expr>(expr, op, right);
     }
     return expr;
 }
 
-std::shared_ptr<Expr> Parser::comparison() {
+Expr* Parser::comparison() {
     auto expr = term();
     while (match(TokenType::GREATER, TokenType::GREATER_EQUAL, TokenType::LESS, TokenType::LESS_EQUAL)) {
         Token op = previous();
         auto right = term();
-        expr = std::make_shared<Binary_Expr>(expr, op, right);
+        expr = m_arena.make<Binary_Expr>(expr, op, right);
     }
     return expr;
 }
 
-std::shared_ptr<Expr> Parser::term() {
+Expr* Parser::term() {
     auto expr = factor();
     while (match(TokenType::PLUS, TokenType::MINUS)) {
         Token op = previous();
         auto right = factor();
-        expr = std::make_shared<Binary_Expr>(expr, op, right);
+        expr = m_arena.make<Binary_Expr>(expr, op, right);
     }
     return expr;
 }
 
-std::shared_ptr<Expr> Parser::factor() {
+Expr* Parser::factor() {
     auto expr = unary();
     while (match(TokenType::STAR, TokenType::SLASH)) {
         Token op = previous();
         auto right = unary();
-        expr = std::make_shared<Binary_Expr>(expr, op, right);
+        expr = m_arena.make<Binary_Expr>(expr, op, right);
     }
     return expr;
 }
 
-std::shared_ptr<Expr> Parser::unary() {
+Expr* Parser::unary() {
     if (match(TokenType::BANG, TokenType::MINUS, TokenType::INCREMENT, TokenType::DECREMENT)) {
         Token op = previous();
         auto right = unary();
-        return std::make_shared<Unary_Expr>(right, op);
+        return m_arena.make<Unary_Expr>(right, op);
     }
     return call();
 }
 
-std::shared_ptr<Expr> Parser::primary() {
-    if (match(TokenType::FALSE)) { return std::make_shared<Literal_Expr>(false); }
+Expr* Parser::primary() {
+    if (match(TokenType::FALSE)) { return m_arena.make<Literal_Expr>(Value::boolean(false)); }
 
-     if (match(TokenType::TRUE)) { return std::make_shared<Literal_Expr>(true); }
+     if (match(TokenType::TRUE)) { return m_arena.make<Literal_Expr>(Value::boolean(true)); }
 
-     if (match(TokenType::NIL)) { return std::make_shared<Literal_Expr>(std::nullopt); }
+     if (match(TokenType::NIL)) { return m_arena.make<Literal_Expr>(Value::nil()); }
 
-    if (match(TokenType::NUMBER, TokenType::STRING)) {
-        const Token& tok = previous();
-        if (!tok.literal().has_value()) {
-            throw std::runtime_error("Literal token has no value.");
-        }
-        return std::make_shared<Literal_Expr>(tok.literal().value());
+    if (match(TokenType::NUMBER)) {
+        const std::string_view digits = previous().lexeme(m_source);
+        double number = 0;
+        std::from_chars(digits.data(), digits.data() + digits.size(), number);
+        return m_arena.make<Literal_Expr>(Value::number(number));
+    }
+
+    if (match(TokenType::STRING)) {
+        const std::string_view quoted = previous().lexeme(m_source);
+        return m_arena.make<Literal_Expr>(Value::object(heap().constant(quoted.substr(1, quoted.size() - 2))));
     }
 
     if (match(TokenType::LEFT_PAREN)) {
-        const std::shared_ptr<Expr> expr = expression();
+        Expr* expr = expression();
         consume(TokenType::RIGHT_PAREN, "Expected ')' after expression.");
-        return std::make_shared<Grouping_Expr>(std::vector<std::shared_ptr<Expr>>{expr});
+        return m_arena.make<Grouping_Expr>(m_arena.array(std::vector<Expr*>{expr}));
     }
 
-    if (match(TokenType::IDENTIFIER)) { return std::make_shared<Variable_Expr>(previous()); }
+    if (match(TokenType::IDENTIFIER)) { return m_arena.make<Variable_Expr>(identifier(previous())); }
+
+    if (match(TokenType::LEFT_BRACKET)) {
+        const Token bracket = previous();
+        std::vector<Expr*> elements;
+        if (!check(TokenType::RIGHT_BRACKET)) {
+            do {
+                elements.push_back(expression());
+            } while (match(TokenType::COMMA));
+        }
+        consume(TokenType::RIGHT_BRACKET, "Expected ']' after array elements.");
+        return m_arena.make<Array_Expr>(bracket, m_arena.array(elements));
+    }
 
     if (peek().type() == TokenType::EndOfFile) { throw std::runtime_error("Unexpected end of input. Perhaps you forgot a semicolon?"); }
 
-    throw std::runtime_error("Unexpected expression near: '" + peek().lexeme() + "'");
+    throw std::runtime_error("Unexpected expression near: '" + std::string(peek().lexeme(m_source)) + "'");
 }
 
-std::shared_ptr<Expr> Parser::call() {
+Expr* Parser::call() {
     auto expr = primary();
     while (true) {
         if (match(TokenType::LEFT_PAREN)) {
             expr = finish_call(expr);
+        } else if (match(TokenType::LEFT_BRACKET)) {
+            const Token bracket = previous();
+            Expr* index = expression();
+            consume(TokenType::RIGHT_BRACKET, "Expected ']' after index.");
+            expr = m_arena.make<Index_Expr>(expr, bracket, index);
         } else {
             break;
         }
@@ -297,20 +341,21 @@ std::shared_ptr<Expr> Parser::call() {
     return expr;
 }
 
-std::shared_ptr<Expr> Parser::finish_call(std::shared_ptr<Expr> callee) {
-    std::vector<std::shared_ptr<Expr>> args;
+Expr* Parser::finish_call(Expr* callee) {
+    std::vector<Expr*> args;
 
     if (!check(TokenType::RIGHT_PAREN)) {
         do {
-            if (args.size() >= 255) {
-                std::cerr << "Too many arguments in the function call.\n";
+            if (args.size() >= MAX_ARGUMENTS) {
+                throw std::runtime_error("Line " + std::to_string(peek().line()) + ": Can't have more than " +
+                                         std::to_string(MAX_ARGUMENTS) + " arguments.");
             }
             args.emplace_back(expression());
         } while (match(TokenType::COMMA));
     }
 
     Token paren = consume(TokenType::RIGHT_PAREN, "Expected ')' after function call.");
-    return std::make_shared<Call_Expr>(callee, paren, args);
+    return m_arena.make<Call_Expr>(callee, paren, m_arena.array(args));
 }
 
 
@@ -318,13 +363,23 @@ bool Parser::check(const TokenType &type) const {
     return !is_at_end() && peek().type() == type;
 }
 
-const Token& Parser::advance() { if (!is_at_end()) { m_pos += 1;} return previous();}
+const Token& Parser::advance() {
+    if (!is_at_end()) {
+        m_pos += 1;
+        m_ring[m_pos % LOOKAHEAD] = m_scanner.next();
+    }
+    return previous();
+}
 bool Parser::is_at_end() const { return peek().type() == TokenType::EndOfFile; }
-const Token& Parser::peek() const { return m_tokens.at(m_pos); }
-const Token& Parser::previous() const { return m_tokens.at(m_pos - 1); }
+const Token& Parser::peek() const { return m_ring[m_pos % LOOKAHEAD]; }
+const Token& Parser::previous() const { return m_ring[(m_pos - 1) % LOOKAHEAD]; }
 const Token& Parser::consume(TokenType type, const std::string& message) {
     if (check(type)) return advance();
     throw std::runtime_error("Line " + std::to_string(peek().line()) + ": " + message +
-                             " (found '" + peek().lexeme() + "')");
+                             " (found '" + std::string(peek().lexeme(m_source)) + "')");
+}
+
+Identifier Parser::identifier(const Token& token) const {
+    return Identifier(heap().constant(token.lexeme(m_source)), token.line());
 }
 
@@ -0,0 +1,127 @@
+#include "../include/profiler.hpp"
+
+#include <algorithm>
+#include <iomanip>
+
+static constexpr size_t NO_LINE = 0;
+
+Profiler::Profiler() {
+    m_functions.emplace_back("<script>", NO_LINE);
+    m_nodes.emplace_back(0, 0);
+    m_functions[0].calls = 1;
+    m_functions[0].active = 1;
+    m_stack.emplace_back(0, NO_LINE, Clock::now());
+}
+
+size_t Profiler::function(const void *key, const std::string_view name, const size_t line) {
+    const auto [it, inserted] = m_ids.try_emplace(key, m_functions.size());
+    if (inserted) {
+        m_functions.emplace_back(std::string(name), line);
+    }
+    return it->second;
+}
+
+void Profiler::enter(const size_t function_id, const size_t call_line) {
+    auto &parent = m_nodes[m_stack.back().node];
+    auto [child, inserted] = parent.children.try_emplace(function_id, m_nodes.size());
+    const size_t node = child->second;
+    if (inserted) {
+        // Adding to m_nodes may reallocate, so `parent` is not used past this point.
+        m_nodes.emplace_back(function_id, m_stack.back().node);
+    }
+
+    auto &stats = m_functions[function_id];
+    stats.calls++;
+    stats.active++;
+    auto &line = m_lines[call_line];
+    line.calls++;
+    line.active++;
+
+    m_stack.emplace_back(node, call_line, Clock::now());
+}
+
+void Profiler::exit() {
+    const Frame frame = m_stack.back();
+    m_stack.pop_back();
+
+    const int64_t total = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - frame.start).count();
+    const int64_t self = total - frame.children_ns;
+    auto &node = m_nodes[frame.node];
+    node.self_ns += self;
+
+    auto &stats = m_functions[node.function_id];
+    stats.self_ns += self;
+    if (--stats.active == 0) { stats.inclusive_ns += total; }
+
+    if (const auto it = m_lines.find(frame.call_line); it != m_lines.end()) {
+        if (--it->second.active == 0) { it->second.inclusive_ns += total; }
+    }
+    if (!m_stack.empty()) { m_stack.back().children_ns += total; }
+}
+
+void Profiler::replace(const size_t function_id, const size_t call_line) {
+    exit();
+    enter(function_id, call_line);
+}
+
+void Profiler::unwind(const size_t depth) {
+    while (m_stack.size() > depth) { exit(); }
+}
+
+void Profiler::finish() { unwind(0); }
+
+std::string Profiler::stackOf(size_t node) const {
+    std::vector<size_t> path;
+    for (; node != 0; node = m_nodes[node].parent) { path.push_back(node); }
+    path.push_back(0);
+
+    std::string stack;
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+        const auto &stats = m_functions[m_nodes[*it].function_id];
+        if (!stack.empty()) { stack += ';'; }
+        stack += stats.name;
+        if (stats.line != NO_LINE) { stack += ':' + std::to_string(stats.line); }
+    }
+    return stack;
+}
+
+// Ranked by self time, then a table of call sites ranked by inclusive time.
+void Profiler::report(std::ostream &out) const {
+    const auto ms = [](const int64_t ns) { return static_cast<double>(ns) / 1e6; };
+
+    std::vector<const FunctionStats *> functions;
+    for (const auto &stats : m_functions) { functions.push_back(&stats); }
+    std::sort(functions.begin(), functions.end(),
+              [](const FunctionStats *a, const FunctionStats *b) { return a->self_ns > b->self_ns; });
+
+    out << std::fixed << std::setprecision(3);
+    out << "\n" << std::left << std::setw(28) << "function" << std::right << std::setw(12) << "calls"
+        << std::setw(14) << "self ms" << std::setw(14) << "incl ms" << '\n';
+    for (const auto *stats : functions) {
+        std::string name = stats->name;
+        if (stats->line != NO_LINE) { name += " (line " + std::to_string(stats->line) + ")"; }
+        out << std::left << std::setw(28) << name << std::right << std::setw(12) << stats->calls
+            << std::setw(14) << ms(stats->self_ns) << std::setw(14) << ms(stats->inclusive_ns) << '\n';
+    }
+
+    std::vector<std::pair<size_t, const LineStats *>> lines;
+    for (const auto &[line, stats] : m_lines) { lines.emplace_back(line, &stats); }
+    std::sort(lines.begin(), lines.end(),
+              [](const auto &a, const auto &b) { return a.second->inclusive_ns > b.second->inclusive_ns; });
+
+    out << "\n" << std::left << std::setw(28) << "call site" << std::right << std::setw(12) << "calls"
+        << std::setw(14) << "" << std::setw(14) << "incl ms" << '\n';
+    for (const auto &[line, stats] : lines) {
+        out << std::left << std::setw(28) << ("line " + std::to_string(line)) << std::right << std::setw(12)
+            << stats->calls << std::setw(14) << "" << std::setw(14) << ms(stats->inclusive_ns) << '\n';
+    }
+}
+
+// One "frame;frame;frame self_microseconds" line per call path, as flamegraph.pl expects.
+void Profiler::writeFolded(std::ostream &out) const {
+    for (size_t node = 0; node < m_nodes.size(); ++node) {
+        if (const int64_t us = m_nodes[node].self_ns / 1000; us > 0) {
+            out << stackOf(node) << ' ' << us << '\n';
+        }
+    }
+}
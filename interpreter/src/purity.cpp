@@ -0,0 +1,181 @@
+#include "../include/purity.hpp"
+
+#include <algorithm>
+
+void PurityAnalysis::analyze(const StmtList statements) {
+    visit(statements);
+
+    // Drop candidates that aren't pure themselves, then those calling a dropped one, until
+    // every remaining candidate only calls remaining candidates.
+    for (const ObjString *name : m_unstable) { m_candidates.erase(name); }
+    std::erase_if(m_candidates, [](const auto &entry) { return !entry.second.pure; });
+    for (bool changed = true; changed;) {
+        changed = std::erase_if(m_candidates, [this](const auto &entry) {
+            return std::ranges::any_of(entry.second.calls, [this](const ObjString *callee) {
+                return !m_candidates.contains(callee);
+            });
+        }) > 0;
+    }
+    for (const auto &[name, candidate] : m_candidates) {
+        candidate.stmt->m_pure = true;
+        candidate.stmt->m_memo_deps = m_arena.array(dependencies(candidate));
+    }
+}
+
+// Every global the candidate calls, and every global those call in turn.
+std::vector<const ObjString *> PurityAnalysis::dependencies(const Candidate &candidate) const {
+    std::vector<const ObjString *> found;
+    std::vector<const Candidate *> pending{&candidate};
+    while (!pending.empty()) {
+        const Candidate *next = pending.back();
+        pending.pop_back();
+        for (const ObjString *callee : next->calls) {
+            if (std::ranges::find(found, callee) != found.end()) { continue; }
+            found.push_back(callee);
+            pending.push_back(&m_candidates.at(callee));
+        }
+    }
+    return found;
+}
+
+void PurityAnalysis::visit(const Expr *expr) {
+    if (expr) expr->accept(*this);
+}
+
+void PurityAnalysis::visit(Stmt *stmt) {
+    if (stmt) stmt->accept(*this);
+}
+
+void PurityAnalysis::visit(const StmtList statements) {
+    for (const auto &stmt : statements) {
+        visit(stmt);
+    }
+}
+
+void PurityAnalysis::declareGlobal(const ObjString *name) {
+    if (!m_declared.insert(name).second) { m_unstable.insert(name); }
+}
+
+void PurityAnalysis::write(const ObjString *name, const int depth) {
+    if (depth < 0) { m_unstable.insert(name); }
+    if (!isLocal(depth)) { impure(); }
+}
+
+void PurityAnalysis::visitBinaryExpr(const Binary_Expr &expr) {
+    visit(expr.m_left);
+    visit(expr.m_right);
+}
+
+void PurityAnalysis::visitGroupingExpr(const Grouping_Expr &expr) {
+    for (const auto &inner : expr.m_exprs) {
+        visit(inner);
+    }
+}
+
+void PurityAnalysis::visitLiteralExpr(const Literal_Expr &) {}
+
+void PurityAnalysis::visitUnaryExpr(const Unary_Expr &expr) {
+    visit(expr.m_operand);
+    if (expr.m_op.type() == TokenType::INCREMENT || expr.m_op.type() == TokenType::DECREMENT) {
+        if (const auto var_expr = dynamic_cast<const Variable_Expr *>(expr.m_operand)) {
+            write(var_expr->m_name.name(), expr.m_depth);
+        }
+    }
+}
+
+void PurityAnalysis::visitVariableExpr(const Variable_Expr &expr) {
+    if (!isLocal(expr.m_depth)) { impure(); }
+}
+
+void PurityAnalysis::visitAssignExpr(const Assign_Expr &expr) {
+    visit(expr.m_value);
+    write(expr.m_name.name(), expr.m_depth);
+}
+
+void PurityAnalysis::visitCallExpr(const Call_Expr &expr) {
+    const auto callee = dynamic_cast<const Variable_Expr *>(expr.m_callee);
+    if (callee && callee->m_depth < 0) {
+        if (m_current) { m_current->calls.push_back(callee->m_name.name()); }
+    } else {
+        // Calling a parameter, a local or the result of an expression.
+        impure();
+        visit(expr.m_callee);
+    }
+    for (const auto &arg : expr.m_args) {
+        visit(arg);
+    }
+}
+
+// A new array each call can't be replaced by a cached one.
+void PurityAnalysis::visitArrayExpr(const Array_Expr &expr) {
+    impure();
+    for (const auto &element : expr.m_elements) {
+        visit(element);
+    }
+}
+
+// Arrays and maps only reach a pure function as arguments, and calls with those aren't cached.
+void PurityAnalysis::visitIndexExpr(const Index_Expr &expr) {
+    visit(expr.m_object);
+    visit(expr.m_index);
+}
+
+void PurityAnalysis::visitIndexSetExpr(const IndexSet_Expr &expr) {
+    impure();
+    visit(expr.m_object);
+    visit(expr.m_index);
+    visit(expr.m_value);
+}
+
+void PurityAnalysis::visitExpressionStmt(const Expression_Stmt &stmt) { visit(stmt.m_expression); }
+
+void PurityAnalysis::visitPrintStmt(const Print_Stmt &stmt) {
+    impure();
+    visit(stmt.m_expression);
+}
+
+void PurityAnalysis::visitVarStmt(const Var_Stmt &stmt) {
+    visit(stmt.m_value);
+    if (stmt.m_slot < 0) { m_unstable.insert(stmt.m_name.name()); }
+}
+
+void PurityAnalysis::visitBlockStmt(const Block_Stmt &stmt) { visit(stmt.m_statements); }
+
+void PurityAnalysis::visitIfStmt(const If_Stmt &stmt) {
+    visit(stmt.m_condition);
+    visit(stmt.m_then_branch);
+    visit(stmt.m_else_branch);
+}
+
+void PurityAnalysis::visitWhileStmt(const While_Stmt &stmt) {
+    visit(stmt.m_condition);
+    visit(stmt.m_body);
+}
+
+void PurityAnalysis::visitForStmt(const For_Stmt &stmt) {
+    visit(stmt.m_initializer);
+    visit(stmt.m_condition);
+    visit(stmt.m_body);
+    visit(stmt.m_step);
+}
+
+void PurityAnalysis::visitFunctionStmt(const Function_Stmt &stmt) {
+    if (stmt.m_slot >= 0 || m_current) {
+        // A closure: whatever it captures may change between calls.
+        impure();
+        visit(stmt.m_statements);
+        return;
+    }
+
+    declareGlobal(stmt.m_name.name());
+    Candidate &candidate = m_candidates.insert_or_assign(stmt.m_name.name(), Candidate{&stmt, true, {}}).first->second;
+    m_current = &candidate;
+    visit(stmt.m_statements);
+    m_current = nullptr;
+}
+
+void PurityAnalysis::visitReturnStmt(const Return_Stmt &stmt) { visit(stmt.m_value); }
+
+void PurityAnalysis::visitBreakStmt(const Break_Stmt &) {}
+
+void PurityAnalysis::visitContinueStmt(const Continue_Stmt &) {}
@@ -0,0 +1,231 @@
+#include "../include/resolver.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+void Resolver::resolve(const StmtList statements) {
+    for (const auto &stmt : statements) {
+        resolve(stmt);
+    }
+}
+
+void Resolver::resolve(Stmt *stmt) {
+    if (stmt) stmt->accept(*this);
+}
+
+void Resolver::resolve(const Expr *expr) {
+    if (expr) expr->accept(*this);
+}
+
+void Resolver::beginScope() {
+    const auto next = static_cast<uint32_t>(frame().next);
+    m_scopes.push_back({{}, {next, next, false}});
+}
+
+// The scope's slots are free again for the next sibling, but stay inside its parent's range.
+ScopeSlots Resolver::endScope() {
+    const ScopeSlots range = m_scopes.back().range;
+    m_scopes.pop_back();
+    frame().next = range.begin;
+    if (!m_scopes.empty()) {
+        auto &parent = m_scopes.back().range;
+        parent.end = std::max(parent.end, range.end);
+    }
+    return range;
+}
+
+// Redeclaring a name in the same scope reuses its slot, matching the VM's SET_LOCAL.
+int Resolver::declare(const ObjString* name) {
+    if (m_scopes.empty()) { return -1; }
+    auto &scope = m_scopes.back();
+    Frame &current = frame();
+    const auto [it, inserted] = scope.slots.try_emplace(name, current.next);
+    if (inserted) {
+        current.next++;
+        current.size = std::max(current.size, current.next);
+        scope.range.end = std::max(scope.range.end, static_cast<uint32_t>(current.next));
+    }
+    return static_cast<int>(it->second);
+}
+
+void Resolver::resolveName(const ObjString* name, int &depth, size_t &slot) {
+    for (size_t i = m_scopes.size(); i-- > 0;) {
+        if (const auto it = m_scopes[i].slots.find(name); it != m_scopes[i].slots.end()) {
+            const size_t boundary = m_functions.empty() ? 0 : m_functions.back().scope;
+            if (i >= boundary) {
+                depth = 0;
+                slot = it->second;
+            } else {
+                depth = 1;
+                slot = capture(m_functions.size() - 1, i, it->second, name);
+            }
+            return;
+        }
+    }
+    depth = -1;
+}
+
+// The upvalue of m_functions[function] for the variable in `slot` of `scope`, which lies
+// outside that function.
+size_t Resolver::capture(const size_t function, const size_t scope, const size_t slot, const ObjString *name) {
+    // Resolution is static, so a name only ever finds one variable outside a given function.
+    if (const auto it = m_functions[function].captured.find(name); it != m_functions[function].captured.end()) {
+        return it->second;
+    }
+    const size_t outer_boundary = function == 0 ? 0 : m_functions[function - 1].scope;
+    Capture source{};
+    if (scope >= outer_boundary) {
+        source.slot = static_cast<uint32_t>(slot);
+        m_scopes[scope].range.captured = true;
+    } else {
+        source.depth = 1;
+        source.slot = static_cast<uint32_t>(capture(function - 1, scope, slot, name));
+    }
+    Function &current = m_functions[function];
+    const size_t index = current.captures.size();
+    current.captured.emplace(name, index);
+    current.captures.push_back(source);
+    return index;
+}
+
+void Resolver::resolveLoopBody(Stmt *body) {
+    m_loop_depth++;
+    resolve(body);
+    m_loop_depth--;
+}
+
+void Resolver::checkInLoop(const Token &keyword) const {
+    if (m_loop_depth == 0) {
+        const char *word = keyword.type() == TokenType::BREAK ? "break" : "continue";
+        throw std::runtime_error("Line " + std::to_string(keyword.line()) + ": Can't use '" + word + "' outside of a loop.");
+    }
+}
+
+void Resolver::visitBinaryExpr(const Binary_Expr &expr) {
+    resolve(expr.m_left);
+    resolve(expr.m_right);
+}
+
+void Resolver::visitGroupingExpr(const Grouping_Expr &expr) {
+    for (const auto &inner : expr.m_exprs) {
+        resolve(inner);
+    }
+}
+
+void Resolver::visitLiteralExpr(const Literal_Expr &) {}
+
+void Resolver::visitUnaryExpr(const Unary_Expr &expr) {
+    resolve(expr.m_operand);
+    if (expr.m_op.type() == TokenType::INCREMENT || expr.m_op.type() == TokenType::DECREMENT) {
+        if (const auto var_expr = dynamic_cast<const Variable_Expr *>(expr.m_operand)) {
+            expr.m_depth = var_expr->m_depth;
+            expr.m_slot = var_expr->m_slot;
+        }
+    }
+}
+
+void Resolver::visitVariableExpr(const Variable_Expr &expr) {
+    resolveName(expr.m_name.name(), expr.m_depth, expr.m_slot);
+}
+
+void Resolver::visitAssignExpr(const Assign_Expr &expr) {
+    resolve(expr.m_value);
+    resolveName(expr.m_name.name(), expr.m_depth, expr.m_slot);
+}
+
+void Resolver::visitCallExpr(const Call_Expr &expr) {
+    resolve(expr.m_callee);
+    for (const auto &arg : expr.m_args) {
+        resolve(arg);
+    }
+}
+
+void Resolver::visitArrayExpr(const Array_Expr &expr) {
+    for (const auto &element : expr.m_elements) {
+        resolve(element);
+    }
+}
+
+void Resolver::visitIndexExpr(const Index_Expr &expr) {
+    resolve(expr.m_object);
+    resolve(expr.m_index);
+}
+
+void Resolver::visitIndexSetExpr(const IndexSet_Expr &expr) {
+    resolve(expr.m_object);
+    resolve(expr.m_index);
+    resolve(expr.m_value);
+}
+
+void Resolver::visitExpressionStmt(const Expression_Stmt &stmt) { resolve(stmt.m_expression); }
+
+void Resolver::visitPrintStmt(const Print_Stmt &stmt) { resolve(stmt.m_expression); }
+
+void Resolver::visitVarStmt(const Var_Stmt &stmt) {
+    // The initializer runs before the name is bound, so `var a = a;` reads the outer `a`.
+    resolve(stmt.m_value);
+    stmt.m_slot = declare(stmt.m_name.name());
+}
+
+void Resolver::visitBlockStmt(const Block_Stmt &stmt) {
+    beginScope();
+    resolve(stmt.m_statements);
+    stmt.m_slots = endScope();
+}
+
+void Resolver::visitIfStmt(const If_Stmt &stmt) {
+    resolve(stmt.m_condition);
+    resolve(stmt.m_then_branch);
+    resolve(stmt.m_else_branch);
+}
+
+void Resolver::visitWhileStmt(const While_Stmt &stmt) {
+    resolve(stmt.m_condition);
+    resolveLoopBody(stmt.m_body);
+}
+
+void Resolver::visitForStmt(const For_Stmt &stmt) {
+    beginScope();
+    resolve(stmt.m_initializer);
+    resolve(stmt.m_condition);
+    resolveLoopBody(stmt.m_body);
+    resolve(stmt.m_step);
+    stmt.m_slots = endScope();
+}
+
+void Resolver::visitFunctionStmt(const Function_Stmt &stmt) {
+    // Declared before the body so the function can call itself.
+    stmt.m_slot = declare(stmt.m_name.name());
+
+    m_functions.push_back({m_scopes.size(), {}, {}, {}});
+    beginScope();
+    Frame &frame = m_functions.back().frame;
+    for (const auto &param : stmt.m_arguments) {
+        // Parameters always occupy slots 0..n-1; a repeated name binds to the last one.
+        m_scopes.back().slots[param.name()] = frame.next++;
+    }
+    frame.size = frame.next;
+    // A loop around the declaration doesn't make break/continue valid inside the body.
+    const size_t enclosing_loops = m_loop_depth;
+    m_loop_depth = 0;
+    resolve(stmt.m_statements);
+    m_loop_depth = enclosing_loops;
+    // The call frame goes with the function, so its scope is not one of the enclosing frame's.
+    m_scopes.pop_back();
+    stmt.m_scope_size = m_functions.back().frame.size;
+    stmt.m_captures = m_arena.array(m_functions.back().captures);
+    m_functions.pop_back();
+}
+
+void Resolver::visitReturnStmt(const Return_Stmt &stmt) {
+    if (m_functions.empty()) {
+        throw std::runtime_error("Line " + std::to_string(stmt.m_keyword.line()) + ": Can't return from top-level code.");
+    }
+    resolve(stmt.m_value);
+    stmt.m_tail_call = dynamic_cast<const Call_Expr *>(stmt.m_value);
+}
+
+void Resolver::visitBreakStmt(const Break_Stmt &stmt) { checkInLoop(stmt.m_keyword); }
+
+void Resolver::visitContinueStmt(const Continue_Stmt &stmt) { checkInLoop(stmt.m_keyword); }
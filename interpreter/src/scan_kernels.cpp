@@ -0,0 +1,111 @@
+#include "../include/scan_kernels.hpp"
+
+#include <bit>
+#include <cstdint>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define LOX_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+static bool isWhitespace(const char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+static const char *findScalar(const char *p, const char *end, const char target, size_t &lines) {
+    for (; p < end && *p != target; ++p) {
+        if (*p == '\n') { lines++; }
+    }
+    return p;
+}
+
+static const char *skipWhitespaceScalar(const char *p, const char *end, size_t &lines) {
+    for (; p < end && isWhitespace(*p); ++p) {
+        if (*p == '\n') { lines++; }
+    }
+    return p;
+}
+
+#ifdef LOX_SCAN_X86
+
+// A block's masks have one bit per byte: `stop` marks where the scan ends, `newlines` the
+// '\n' bytes. Returns the offset of the first stop, counting the newlines before it.
+template<typename Mask>
+static bool stopIn(const Mask stop, const Mask newlines, size_t &offset, size_t &lines) {
+    if (stop == 0) {
+        lines += std::popcount(newlines);
+        return false;
+    }
+    offset = std::countr_zero(stop);
+    lines += std::popcount(static_cast<Mask>(newlines & ((Mask{1} << offset) - 1)));
+    return true;
+}
+
+static const char *findSse2(const char *p, const char *end, const char target, size_t &lines) {
+    const __m128i wanted = _mm_set1_epi8(target);
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; end - p >= 16; p += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        const auto stop = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, wanted)));
+        const auto newlines = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)));
+        if (size_t offset; stopIn(stop, newlines, offset, lines)) { return p + offset; }
+    }
+    return findScalar(p, end, target, lines);
+}
+
+static const char *skipWhitespaceSse2(const char *p, const char *end, size_t &lines) {
+    const __m128i space = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t');
+    const __m128i cr = _mm_set1_epi8('\r'), newline = _mm_set1_epi8('\n');
+    for (; end - p >= 16; p += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        const __m128i is_newline = _mm_cmpeq_epi8(block, newline);
+        const __m128i blank = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, tab)),
+                                           _mm_or_si128(_mm_cmpeq_epi8(block, cr), is_newline));
+        const auto stop = static_cast<uint16_t>(~_mm_movemask_epi8(blank));
+        const auto newlines = static_cast<uint16_t>(_mm_movemask_epi8(is_newline));
+        if (size_t offset; stopIn(stop, newlines, offset, lines)) { return p + offset; }
+    }
+    return skipWhitespaceScalar(p, end, lines);
+}
+
+__attribute__((target("avx2")))
+static const char *findAvx2(const char *p, const char *end, const char target, size_t &lines) {
+    const __m256i wanted = _mm256_set1_epi8(target);
+    const __m256i newline = _mm256_set1_epi8('\n');
+    for (; end - p >= 32; p += 32) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        const auto stop = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, wanted)));
+        const auto newlines = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline)));
+        if (size_t offset; stopIn(stop, newlines, offset, lines)) { return p + offset; }
+    }
+    return findSse2(p, end, target, lines);
+}
+
+__attribute__((target("avx2")))
+static const char *skipWhitespaceAvx2(const char *p, const char *end, size_t &lines) {
+    const __m256i space = _mm256_set1_epi8(' '), tab = _mm256_set1_epi8('\t');
+    const __m256i cr = _mm256_set1_epi8('\r'), newline = _mm256_set1_epi8('\n');
+    for (; end - p >= 32; p += 32) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        const __m256i is_newline = _mm256_cmpeq_epi8(block, newline);
+        const __m256i blank =
+            _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, space), _mm256_cmpeq_epi8(block, tab)),
+                            _mm256_or_si256(_mm256_cmpeq_epi8(block, cr), is_newline));
+        const auto stop = ~static_cast<uint32_t>(_mm256_movemask_epi8(blank));
+        const auto newlines = static_cast<uint32_t>(_mm256_movemask_epi8(is_newline));
+        if (size_t offset; stopIn(stop, newlines, offset, lines)) { return p + offset; }
+    }
+    return skipWhitespaceSse2(p, end, lines);
+}
+
+#endif
+
+const ScanKernels &scanKernels() {
+    static const ScanKernels kernels = [] {
+#ifdef LOX_SCAN_X86
+        if (__builtin_cpu_supports("avx2")) { return ScanKernels{findAvx2, skipWhitespaceAvx2, "avx2"}; }
+        return ScanKernels{findSse2, skipWhitespaceSse2, "sse2"};
+#else
+        return ScanKernels{findScalar, skipWhitespaceScalar, "scalar"};
+#endif
+    }();
+    return kernels;
+}
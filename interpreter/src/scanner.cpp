@@ -1,16 +1,113 @@
 #include "../include/scanner.hpp"
 
+#include <array>
+#include <cstdint>
 #include <iostream>
+#include <stdexcept>
 #include <vector>
 #include <string>
 
-std::vector<Token> Scanner::scan() {
+// Character classes, indexed by the byte itself; unlike <cctype> this ignores the locale.
+enum CharClass : uint8_t {
+    DIGIT = 1 << 0,
+    IDENT_START = 1 << 1,
+    IDENT = DIGIT | IDENT_START,
+};
+
+static constexpr std::array<uint8_t, 256> CHAR_CLASSES = [] {
+    std::array<uint8_t, 256> classes {};
+    for (int c = '0'; c <= '9'; ++c) { classes[c] = DIGIT; }
+    for (int c = 'a'; c <= 'z'; ++c) { classes[c] = IDENT_START; }
+    for (int c = 'A'; c <= 'Z'; ++c) { classes[c] = IDENT_START; }
+    classes['_'] = IDENT_START;
+    return classes;
+}();
+
+static constexpr bool is(const char c, const uint8_t classes) {
+    return (CHAR_CLASSES[static_cast<uint8_t>(c)] & classes) != 0;
+}
+
+// The keyword `word` would be if its remaining characters from `start` on are `rest`.
+static constexpr TokenType keywordIf(const std::string_view word, const size_t start, const std::string_view rest,
+                                     const TokenType type) {
+    return word.size() == start + rest.size() && word.substr(start) == rest ? type : TokenType::IDENTIFIER;
+}
+
+// A trie unrolled into switches on the first (and, where they share one, second) character,
+// so an identifier costs at most one short comparison against a keyword.
+static constexpr TokenType keywordType(const std::string_view word) {
+    switch (word[0]) {
+        case 'a': return keywordIf(word, 1, "nd", TokenType::AND);
+        case 'b': return keywordIf(word, 1, "reak", TokenType::BREAK);
+        case 'c':
+            if (word.size() > 1) {
+                switch (word[1]) {
+                    case 'l': return keywordIf(word, 2, "ass", TokenType::CLASS);
+                    case 'o': return keywordIf(word, 2, "ntinue", TokenType::CONTINUE);
+                    default: break;
+                }
+            }
+            break;
+        case 'e': return keywordIf(word, 1, "lse", TokenType::ELSE);
+        case 'f':
+            if (word.size() > 1) {
+                switch (word[1]) {
+                    case 'a': return keywordIf(word, 2, "lse", TokenType::FALSE);
+                    case 'o': return keywordIf(word, 2, "r", TokenType::FOR);
+                    case 'u': return keywordIf(word, 2, "n", TokenType::FUN);
+                    default: break;
+                }
+            }
+            break;
+        case 'i': return keywordIf(word, 1, "f", TokenType::IF);
+        case 'n': return keywordIf(word, 1, "il", TokenType::NIL);
+        case 'o': return keywordIf(word, 1, "r", TokenType::OR);
+        case 'p': return keywordIf(word, 1, "rint", TokenType::PRINT);
+        case 'r': return keywordIf(word, 1, "eturn", TokenType::RETURN);
+        case 's': return keywordIf(word, 1, "uper", TokenType::SUPER);
+        case 't':
+            if (word.size() > 1) {
+                switch (word[1]) {
+                    case 'h': return keywordIf(word, 2, "is", TokenType::THIS);
+                    case 'r': return keywordIf(word, 2, "ue", TokenType::TRUE);
+                    default: break;
+                }
+            }
+            break;
+        case 'v': return keywordIf(word, 1, "ar", TokenType::VAR);
+        case 'w': return keywordIf(word, 1, "hile", TokenType::WHILE);
+        default: break;
+    }
+    return TokenType::IDENTIFIER;
+}
+
+static_assert(keywordType("and") == TokenType::AND && keywordType("break") == TokenType::BREAK &&
+              keywordType("class") == TokenType::CLASS && keywordType("continue") == TokenType::CONTINUE &&
+              keywordType("else") == TokenType::ELSE && keywordType("false") == TokenType::FALSE &&
+              keywordType("for") == TokenType::FOR && keywordType("fun") == TokenType::FUN &&
+              keywordType("if") == TokenType::IF && keywordType("nil") == TokenType::NIL &&
+              keywordType("or") == TokenType::OR && keywordType("print") == TokenType::PRINT &&
+              keywordType("return") == TokenType::RETURN && keywordType("super") == TokenType::SUPER &&
+              keywordType("this") == TokenType::THIS && keywordType("true") == TokenType::TRUE &&
+              keywordType("var") == TokenType::VAR && keywordType("while") == TokenType::WHILE);
+static_assert(keywordType("c") == TokenType::IDENTIFIER && keywordType("fork") == TokenType::IDENTIFIER &&
+              keywordType("th") == TokenType::IDENTIFIER && keywordType("variable") == TokenType::IDENTIFIER);
+
+Scanner::Scanner(const std::string_view src) : m_src(src) {
+    if (m_src.size() > UINT32_MAX) { throw std::runtime_error("Source is larger than 4 GiB."); }
+}
+
+Token Scanner::next() {
     while (!isAtEnd()) {
         m_start = m_current;
         scanToken();
+        if (m_token) {
+            const Token token = *m_token;
+            m_token.reset();
+            return token;
+        }
     }
-    m_tokens.emplace_back(Token{TokenType::EndOfFile, "", std::nullopt, m_line});
-    return m_tokens;
+    return {TokenType::EndOfFile, static_cast<uint32_t>(m_current), 0, static_cast<uint32_t>(m_line)};
 }
 
 bool Scanner::isAtEnd() const {
@@ -20,65 +117,56 @@ bool Scanner::isAtEnd() const {
 void Scanner::scanToken() {
     char c = advance();
     switch (c) {
-        case '(': addNullToken(TokenType::LEFT_PAREN); break;
-        case ')': addNullToken(TokenType::RIGHT_PAREN); break;
-        case '{': addNullToken(TokenType::LEFT_BRACE); break;
-        case '}': addNullToken(TokenType::RIGHT_BRACE); break;
-        case ',': addNullToken(TokenType::COMMA); break;
-        case '.': addNullToken(TokenType::DOT); break;
+        case '(': addToken(TokenType::LEFT_PAREN); break;
+        case ')': addToken(TokenType::RIGHT_PAREN); break;
+        case '{': addToken(TokenType::LEFT_BRACE); break;
+        case '}': addToken(TokenType::RIGHT_BRACE); break;
+        case '[': addToken(TokenType::LEFT_BRACKET); break;
+        case ']': addToken(TokenType::RIGHT_BRACKET); break;
+        case ',': addToken(TokenType::COMMA); break;
+        case '.': addToken(TokenType::DOT); break;
         case '-': {
             if (match('-')) {
-                addNullToken(TokenType::DECREMENT);
+                addToken(TokenType::DECREMENT);
             } else {
-                addNullToken(TokenType::MINUS);
+                addToken(TokenType::MINUS);
             }
+            break;
         }
         case '+': {
             if (match('+')) {
-                addNullToken(TokenType::INCREMENT);
+                addToken(TokenType::INCREMENT);
             } else {
-                addNullToken(TokenType::PLUS);
+                addToken(TokenType::PLUS);
             }
             break;
         }
         case '/': {
             if (match('/')) {
-                while (peek() != '\n' && !isAtEnd()) {
-                    advance();
-                }
+                lineComment();
             } else if (match('*')) {
-                while (!isAtEnd()) {
-                    if (peek() == '*' && peekNext() == '/') {
-                        advance(); // Consume the star
-                        advance(); // Then consume the slash
-                        break;
-                    } else {
-                        if (peek() == '\n') { m_line++; }
-                        advance();
-                    }
-                }
-                if (isAtEnd()) {
-                    std::cerr << "Error! Unterminated multiline comment on line: " << m_line << '\n';
-                }
+                blockComment();
             } else {
-                addNullToken(TokenType::SLASH);
+                addToken(TokenType::SLASH);
             }
             break;
         }
-        case '*': addNullToken(TokenType::STAR); break;
-        case ';': addNullToken(TokenType::SEMICOLON); break;
-        case '!': addNullToken(match('=') ? TokenType::BANG_EQUAL : TokenType::BANG); break;
-        case '=': addNullToken(match('=') ? TokenType::EQUAL_EQUAL : TokenType::EQUAL); break;
-        case '<': addNullToken(match('=') ? TokenType::LESS_EQUAL : TokenType::LESS); break;
-        case '>': addNullToken(match('=') ? TokenType::GREATER_EQUAL : TokenType::GREATER); break;
+        case '*': addToken(TokenType::STAR); break;
+        case ';': addToken(TokenType::SEMICOLON); break;
+        case '!': addToken(match('=') ? TokenType::BANG_EQUAL : TokenType::BANG); break;
+        case '=': addToken(match('=') ? TokenType::EQUAL_EQUAL : TokenType::EQUAL); break;
+        case '<': addToken(match('=') ? TokenType::LESS_EQUAL : TokenType::LESS); break;
+        case '>': addToken(match('=') ? TokenType::GREATER_EQUAL : TokenType::GREATER); break;
+
+        case '\n':
+            m_line++;
+            skipWhitespace();
+            break;
 
         case ' ':
         case '\r':
         case '\t':
-            break;
-
-        case '\n':
-            m_line++;
+            skipWhitespace();
             break;
 
         case '\"':
@@ -86,9 +174,9 @@ void Scanner::scanToken() {
             break;
 
         default: {
-            if (isdigit(c)) {
+            if (is(c, DIGIT)) {
                 number();
-            } else if (isalpha(c) || c == '_') {
+            } else if (is(c, IDENT_START)) {
                 identifier();
             } else {
                 std::cerr << "Error! Unknown token: " << c << '\n';
@@ -98,23 +186,23 @@ void Scanner::scanToken() {
     }
 }
 
-char Scanner::advance() { return m_src.at(m_current++); }
+char Scanner::advance() { return m_src[m_current++]; }
 
 char Scanner::peek() const {
     if (isAtEnd()) { return '\0'; }
-    return m_src.at(m_current);
+    return m_src[m_current];
 }
 
 char Scanner::peekNext() const {
     if (isAtEnd() || m_current + 1 >= m_src.length()) { return '\0'; }
-    return m_src.at(m_current + 1);
+    return m_src[m_current + 1];
 }
 
 bool Scanner::match(const char expected) {
     if (isAtEnd()) {
         return false;
     } else {
-        if (m_src.at(m_current) != expected) {
+        if (m_src[m_current] != expected) {
             return false;
         }
     }
@@ -122,58 +210,63 @@ bool Scanner::match(const char expected) {
     return true;
 }
 
-void Scanner::string() {
-    while (!isAtEnd() && peek() != '\"') {
-        if (peek() == '\n') { m_line++; }
-        advance();
+void Scanner::skipWhitespace() {
+    const char *end = m_src.data() + m_src.size();
+    m_current = m_kernels.skipWhitespace(m_src.data() + m_current, end, m_line) - m_src.data();
+}
+
+void Scanner::lineComment() {
+    // The newline itself is left for scanToken().
+    size_t lines = 0;
+    const char *end = m_src.data() + m_src.size();
+    m_current = m_kernels.find(m_src.data() + m_current, end, '\n', lines) - m_src.data();
+}
+
+void Scanner::blockComment() {
+    const char *end = m_src.data() + m_src.size();
+    const char *star = m_src.data() + m_current;
+    while ((star = m_kernels.find(star, end, '*', m_line)) != end) {
+        if (star + 1 < end && star[1] == '/') {
+            m_current = star + 2 - m_src.data();
+            return;
+        }
+        star++;
     }
-    if (isAtEnd()) {
+    m_current = m_src.size();
+    std::cerr << "Error! Unterminated multiline comment on line: " << m_line << '\n';
+}
+
+void Scanner::string() {
+    const char *end = m_src.data() + m_src.size();
+    const char *quote = m_kernels.find(m_src.data() + m_current, end, '\"', m_line);
+    if (quote == end) {
         std::cerr << "Error! Unterminated string\n";
         exit(1);
     }
-    advance();
-
-    const std::string str = m_src.substr(m_start + 1, m_current - m_start - 2);
-    addToken(TokenType::STRING, str);
+    m_current = quote + 1 - m_src.data();
+    addToken(TokenType::STRING);
 }
 
 void Scanner::number() {
-    while (!isAtEnd() && isdigit(peek())) {
+    while (!isAtEnd() && is(peek(), DIGIT)) {
         advance();
     }
-    if (peek() == '.' && isdigit(peekNext())) {
+    if (peek() == '.' && is(peekNext(), DIGIT)) {
         advance();
-        while (isdigit(peek())) {
+        while (is(peek(), DIGIT)) {
             advance();
         }
     }
-    std::string str_num = m_src.substr(m_start, m_current - m_start);
-    addToken(TokenType::NUMBER, stod(str_num));
+    addToken(TokenType::NUMBER);
 }
 
 void Scanner::identifier() {
-    while (!isAtEnd() && (isalnum(peek()) || peek() == '_')) { advance(); }
-    const std::string str = m_src.substr(m_start, m_current - m_start);
-    auto it = keywords.find(str);
-    if (it == keywords.end()) {
-        addToken(TokenType::IDENTIFIER, str);
-    } else {
-        if (it->second == TokenType::TRUE) {
-            addToken(TokenType::TRUE, true);
-        } else if (it->second == TokenType::FALSE) {
-            addToken(TokenType::FALSE, false);
-        } else if (it->second == TokenType::NIL) {
-            addToken(TokenType::NIL, std::nullopt);
-        } else {
-            addNullToken(it->second);
-        }
-
-    }
+    while (m_current < m_src.size() && is(m_src[m_current], IDENT)) { m_current++; }
+    const std::string_view str = m_src.substr(m_start, m_current - m_start);
+    addToken(keywordType(str));
 }
 
-void Scanner::addNullToken(const TokenType &type) { addToken(type, std::nullopt); }
-
-void Scanner::addToken(const TokenType &type, const OptionalLiteral &literal) {
-    std::string text = m_src.substr(m_start, m_current - m_start);
-    m_tokens.emplace_back(type, std::move(text), literal, m_line);
+void Scanner::addToken(const TokenType &type) {
+    m_token.emplace(type, static_cast<uint32_t>(m_start), static_cast<uint32_t>(m_current - m_start),
+                    static_cast<uint32_t>(m_line));
 }
@@ -0,0 +1,50 @@
+#include "../include/source.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+Source Source::map(const char *path) {
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open file " + std::string(path) + ": " + std::strerror(errno));
+    }
+    struct stat info {};
+    if (fstat(fd, &info) < 0) {
+        const int error = errno;
+        close(fd);
+        throw std::runtime_error("Failed to stat file " + std::string(path) + ": " + std::strerror(error));
+    }
+
+    Source source;
+    // mmap() rejects a zero length; an empty script is just an empty string.
+    if (info.st_size > 0) {
+        void *data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            const int error = errno;
+            close(fd);
+            throw std::runtime_error("Failed to map file " + std::string(path) + ": " + std::strerror(error));
+        }
+        // The scanner reads the file front to back exactly once.
+        madvise(data, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+        source.m_mapped = static_cast<const char *>(data);
+        source.m_size = static_cast<size_t>(info.st_size);
+    }
+    close(fd);
+    return source;
+}
+
+Source::Source(Source &&other) noexcept
+    : m_owned(std::move(other.m_owned)), m_mapped(other.m_mapped), m_size(other.m_size) {
+    other.m_mapped = nullptr;
+    other.m_size = 0;
+}
+
+Source::~Source() {
+    if (m_mapped) { munmap(const_cast<char *>(m_mapped), m_size); }
+}
@@ -0,0 +1,432 @@
+#include "../include/vm.hpp"
+#include "../include/compiler.hpp"
+#include "../include/interpreter.hpp"
+#include "../include/natives.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+Value VmClosure::call(Interpreter &, std::span<const Value>) {
+    throw std::runtime_error("Bytecode functions can only be called from the VM.");
+}
+
+VM::VM() {
+    m_stack.resize(STACK_INITIAL);
+    heap().addRoots(this);
+    for (NativeFunction *native : natives()) {
+        m_globals[native->m_name] = Value::object(native);
+    }
+}
+
+void VM::interpret(const StmtList statements) {
+    Compiler compiler;
+    auto *closure = heap().make<VmClosure>(compiler.compile(statements));
+
+    reserveStack(closure->m_function->m_max_stack);
+    m_stack[0] = Value::object(closure);
+    m_stack_top = 1;
+    m_frames.push_back({closure, closure->m_function->m_chunk.m_code.data(), 0});
+    if (m_profiler) { m_profiler_depth = m_profiler->depth(); }
+
+    try {
+        run();
+    } catch (...) {
+        reset();
+        throw;
+    }
+}
+
+// Open upvalues point into the stack and closed ones are traced through their closures, so
+// the live part of the stack and the globals (names too) are all the VM has to report. Each frame's
+// closure sits in its slot 0. run() stores m_stack_top before anything that can allocate.
+void VM::markRoots(Heap &heap) {
+    for (size_t i = 0; i < m_stack_top; ++i) { heap.mark(m_stack[i]); }
+    for (const auto &[name, value] : m_globals) {
+        heap.mark(const_cast<ObjString *>(name));
+        heap.mark(value);
+    }
+    for (const Value value : m_memo_keys) { heap.mark(value); }
+}
+
+void VM::reset() {
+    if (m_profiler) { m_profiler->unwind(m_profiler_depth); }
+    m_frames.clear();
+    m_open_upvalues.clear();
+    m_memo_keys.clear();
+    m_stack_top = 0;
+}
+
+void VM::reserveStack(const size_t needed) {
+    if (needed <= m_stack.size()) { return; }
+    m_stack.resize(std::max(needed, m_stack.size() * 2));
+}
+
+std::shared_ptr<VmUpvalue> VM::captureUpvalue(const size_t slot) {
+    // Kept sorted by slot so closing a frame only touches its tail.
+    auto it = std::lower_bound(m_open_upvalues.begin(), m_open_upvalues.end(), slot,
+        [](const std::shared_ptr<VmUpvalue> &upvalue, const size_t s) { return upvalue->m_slot < s; });
+    if (it != m_open_upvalues.end() && (*it)->m_slot == slot) {
+        return *it;
+    }
+    auto created = std::make_shared<VmUpvalue>(slot);
+    m_open_upvalues.insert(it, created);
+    return created;
+}
+
+void VM::closeUpvalues(const size_t from_slot) {
+    while (!m_open_upvalues.empty() && m_open_upvalues.back()->m_slot >= from_slot) {
+        auto &upvalue = *m_open_upvalues.back();
+        upvalue.m_closed = m_stack[upvalue.m_slot];
+        upvalue.m_open = false;
+        m_open_upvalues.pop_back();
+    }
+}
+
+void VM::run() {
+    CallFrame *frame = &m_frames.back();
+    const Chunk *chunk = &frame->closure->m_function->m_chunk;
+    const uint8_t *ip = frame->ip;
+    Value *slots = m_stack.data() + frame->base;
+    Value *sp = m_stack.data() + m_stack_top;
+
+    auto readByte = [&ip]() { return *ip++; };
+    auto readShort = [&ip]() {
+        ip += 2;
+        return static_cast<uint16_t>((ip[-2] << 8) | ip[-1]);
+    };
+    // The index operand of `op`, wider when it is a *_LONG form.
+    auto readIndex = [&ip, &readShort](const OpCode op, const OpCode long_op) -> size_t {
+        if (op != long_op) { return readShort(); }
+        ip += 3;
+        return static_cast<size_t>((ip[-3] << 16) | (ip[-2] << 8) | ip[-1]);
+    };
+    auto numberOperands = [&sp](const char *message) {
+        if (sp[-2].isNil() || sp[-1].isNil()) { throw std::runtime_error("Operands must not be nil."); }
+        if (!sp[-2].isNumber() || !sp[-1].isNumber()) {
+            throw std::runtime_error(message);
+        }
+    };
+
+    while (true) {
+        switch (const auto op = static_cast<OpCode>(readByte())) {
+            case OpCode::CONSTANT:
+            case OpCode::CONSTANT_LONG: *sp++ = chunk->m_constants[readIndex(op, OpCode::CONSTANT_LONG)]; break;
+            case OpCode::NIL: *sp++ = Value::nil(); break;
+            case OpCode::TRUE: *sp++ = Value::boolean(true); break;
+            case OpCode::FALSE: *sp++ = Value::boolean(false); break;
+            case OpCode::POP: --sp; break;
+
+            case OpCode::GET_LOCAL: *sp++ = slots[readShort()]; break;
+            case OpCode::SET_LOCAL: slots[readShort()] = sp[-1]; break;
+            case OpCode::GET_GLOBAL:
+            case OpCode::GET_GLOBAL_LONG: {
+                const ObjString *name = chunk->m_names[readIndex(op, OpCode::GET_GLOBAL_LONG)];
+                const auto it = m_globals.find(name);
+                if (it == m_globals.end()) { throw std::runtime_error("Undefined variable '" + name->m_chars + "'."); }
+                *sp++ = it->second;
+                break;
+            }
+            case OpCode::DEFINE_GLOBAL:
+            case OpCode::DEFINE_GLOBAL_LONG: {
+                const ObjString *name = chunk->m_names[readIndex(op, OpCode::DEFINE_GLOBAL_LONG)];
+                if (const auto [it, inserted] = m_globals.try_emplace(name, sp[-1]); !inserted) {
+                    overwriteGlobal(name, it->second, sp[-1]);
+                }
+                --sp;
+                break;
+            }
+            case OpCode::SET_GLOBAL:
+            case OpCode::SET_GLOBAL_LONG: {
+                const ObjString *name = chunk->m_names[readIndex(op, OpCode::SET_GLOBAL_LONG)];
+                const auto it = m_globals.find(name);
+                if (it == m_globals.end()) { throw std::runtime_error("Undefined variable '" + name->m_chars + "'."); }
+                overwriteGlobal(name, it->second, sp[-1]);
+                break;
+            }
+            case OpCode::GET_UPVALUE: *sp++ = upvalueRef(*frame->closure->m_upvalues[readShort()]); break;
+            case OpCode::SET_UPVALUE: upvalueRef(*frame->closure->m_upvalues[readShort()]) = sp[-1]; break;
+            case OpCode::CLOSE_UPVALUE:
+                closeUpvalues(sp - m_stack.data() - 1);
+                --sp;
+                break;
+
+            case OpCode::EQUAL:
+            case OpCode::NOT_EQUAL: {
+                const bool negate = ip[-1] == static_cast<uint8_t>(OpCode::NOT_EQUAL);
+                if (sp[-2].isNil() || sp[-1].isNil()) { throw std::runtime_error("Operands must not be nil."); }
+                const bool eq = sp[-2] == sp[-1];
+                --sp;
+                sp[-1] = Value::boolean(negate ? !eq : eq);
+                break;
+            }
+            case OpCode::GREATER:
+            case OpCode::GREATER_EQUAL:
+            case OpCode::LESS:
+            case OpCode::LESS_EQUAL: {
+                const auto op = static_cast<OpCode>(ip[-1]);
+                const Value left = sp[-2];
+                const Value right = sp[-1];
+                if (left.isNil() || right.isNil()) { throw std::runtime_error("Operands must not be nil."); }
+                int order;
+                if (left.isNumber() && right.isNumber()) {
+                    const double l = left.asNumber(), r = right.asNumber();
+                    // NaN compares false every way, which the fallthrough below preserves.
+                    order = l < r ? -1 : (l > r ? 1 : (l == r ? 0 : 2));
+                } else if (left.isString() && right.isString()) {
+                    const int cmp = left.asChars().compare(right.asChars());
+                    order = cmp < 0 ? -1 : (cmp > 0 ? 1 : 0);
+                } else {
+                    throw std::runtime_error("Operands for comparison must either be two numbers or two strings.");
+                }
+                bool result;
+                if (op == OpCode::GREATER) result = order == 1;
+                else if (op == OpCode::GREATER_EQUAL) result = order == 1 || order == 0;
+                else if (op == OpCode::LESS) result = order == -1;
+                else result = order == -1 || order == 0;
+                --sp;
+                sp[-1] = Value::boolean(result);
+                break;
+            }
+            case OpCode::ADD: {
+                const Value left = sp[-2];
+                const Value right = sp[-1];
+                if (left.isNumber() && right.isNumber()) {
+                    sp[-2] = Value::number(left.asNumber() + right.asNumber());
+                } else if (left.isNil() || right.isNil()) {
+                    throw std::runtime_error("Operands must not be nil.");
+                } else if (left.isString() && right.isString()) {
+                    m_stack_top = sp - m_stack.data();
+                    sp[-2] = Value::object(heap().concat(left, right));
+                } else {
+                    throw std::runtime_error("Operands must either be numbers or two strings.");
+                }
+                --sp;
+                break;
+            }
+            case OpCode::SUBTRACT:
+                numberOperands("Operands must not be numbers.");
+                sp[-2] = Value::number(sp[-2].asNumber() - sp[-1].asNumber());
+                --sp;
+                break;
+            case OpCode::DIVIDE:
+                numberOperands("Operands must not be numbers.");
+                if (sp[-1].asNumber() == 0.0) { throw std::runtime_error("Error! Division by zero."); }
+                sp[-2] = Value::number(sp[-2].asNumber() / sp[-1].asNumber());
+                --sp;
+                break;
+            case OpCode::MULTIPLY: {
+                const Value left = sp[-2];
+                const Value right = sp[-1];
+                if (left.isNumber() && right.isNumber()) {
+                    sp[-2] = Value::number(left.asNumber() * right.asNumber());
+                } else if (left.isNil() || right.isNil()) {
+                    throw std::runtime_error("Operands must not be nil.");
+                } else if (left.isString() && right.isNumber()) {
+                    m_stack_top = sp - m_stack.data();
+                    sp[-2] = Value::object(heap().repeat(left.asChars(), right.asNumber()));
+                } else if (left.isNumber() && right.isString()) {
+                    m_stack_top = sp - m_stack.data();
+                    sp[-2] = Value::object(heap().repeat(right.asChars(), left.asNumber()));
+                } else {
+                    throw std::runtime_error("Unsupported operands for \'*\'");
+                }
+                --sp;
+                break;
+            }
+            case OpCode::NOT: sp[-1] = Value::boolean(sp[-1].isFalsey()); break;
+            case OpCode::NEGATE:
+                if (!sp[-1].isNumber()) { throw std::runtime_error("Invalid operand"); }
+                sp[-1] = Value::number(-sp[-1].asNumber());
+                break;
+            case OpCode::INCREMENT:
+            case OpCode::DECREMENT:
+                if (!sp[-1].isNumber()) {
+                    throw std::runtime_error(R"(Invalid operand for either '++' or '--', must be a variable.)");
+                }
+                sp[-1] = Value::number(sp[-1].asNumber() + (ip[-1] == static_cast<uint8_t>(OpCode::INCREMENT) ? 1.0 : -1.0));
+                break;
+            case OpCode::CHECK_NUMBER:
+                if (!sp[-1].isNumber()) {
+                    throw std::runtime_error("[ERROR] Unknown literal type for the for-loop initializer.");
+                }
+                break;
+
+            case OpCode::ARRAY: {
+                const uint16_t count = readShort();
+                for (const Value *element = sp - count; element < sp; ++element) {
+                    if (!element->isNumber()) { throw std::runtime_error("Array elements must be numbers."); }
+                }
+                m_stack_top = sp - m_stack.data();
+                auto *array = heap().make<ObjArray>(count);
+                for (size_t i = 0; i < count; ++i) { array->m_values[i] = sp[i - count].asNumber(); }
+                sp -= count;
+                *sp++ = Value::object(array);
+                break;
+            }
+            case OpCode::GET_INDEX:
+                sp[-2] = getIndex(sp[-2], sp[-1]);
+                --sp;
+                break;
+            case OpCode::SET_INDEX:
+                m_stack_top = sp - m_stack.data();
+                setIndex(sp[-3], sp[-2], sp[-1]);
+                sp[-3] = sp[-1];
+                sp -= 2;
+                break;
+
+            case OpCode::PRINT: Interpreter::print(*--sp); break;
+            case OpCode::JUMP: {
+                const uint16_t offset = readShort();
+                ip += offset;
+                break;
+            }
+            case OpCode::JUMP_IF_FALSE: {
+                const uint16_t offset = readShort();
+                if ((--sp)->isFalsey()) { ip += offset; }
+                break;
+            }
+            case OpCode::LOOP: {
+                const uint16_t offset = readShort();
+                ip -= offset;
+                break;
+            }
+            case OpCode::TAIL_CALL: {
+                // Calls to closures replace the current frame, in the profiler too: the callee and
+                // arguments move down to its base and the function starts over there. Anything
+                // else is an ordinary CALL, whose result the RETURN that follows hands back.
+                const uint8_t arg_count = *ip;
+                const Value callee = sp[-1 - arg_count];
+                auto *closure = callee.isCallable()
+                    ? dynamic_cast<VmClosure *>(static_cast<LoxCallable *>(callee.asObj())) : nullptr;
+                if (closure && arg_count == closure->m_function->m_arity) {
+                    if (m_profiler) {
+                        const VmFunction &function = *closure->m_function;
+                        const size_t call_offset = ip - chunk->m_code.data() - 1;
+                        m_profiler->replace(m_profiler->function(function.m_declaration, function.m_name,
+                                                                 function.m_line),
+                                            chunk->m_lines[call_offset]);
+                    }
+                    const size_t base = frame->base;
+                    closeUpvalues(base);
+                    std::copy(sp - arg_count - 1, sp, slots);
+                    m_stack_top = base + arg_count + 1;
+                    reserveStack(base + closure->m_function->m_max_stack);
+
+                    frame->closure = closure;
+                    chunk = &closure->m_function->m_chunk;
+                    ip = chunk->m_code.data();
+                    slots = m_stack.data() + base;
+                    sp = m_stack.data() + m_stack_top;
+                    break;
+                }
+            }
+            [[fallthrough]];
+            case OpCode::CALL: {
+                const uint8_t arg_count = readByte();
+                const Value callee = sp[-1 - arg_count];
+                if (!callee.isCallable()) {
+                    throw std::runtime_error("Error, attempted to call a nil value.");
+                }
+                auto *callable = static_cast<LoxCallable *>(callee.asObj());
+                auto *closure = dynamic_cast<VmClosure *>(callable);
+                if (!closure) {
+                    if (auto *native = dynamic_cast<NativeFunction *>(callable)) {
+                        if (arg_count != native->m_arity) {
+                            throw std::runtime_error("Error, wrong number of arguments.");
+                        }
+                        // Natives may allocate; their arguments stay on the stack until they return.
+                        m_stack_top = sp - m_stack.data();
+                        if (m_profiler) {
+                            const size_t call_offset = ip - chunk->m_code.data() - 2;
+                            m_profiler->enter(m_profiler->function(native, native->m_name->m_chars, 0),
+                                              chunk->m_lines[call_offset]);
+                        }
+                        const Value result = native->m_function({sp - arg_count, arg_count});
+                        if (m_profiler) { m_profiler->exit(); }
+                        sp -= arg_count;
+                        sp[-1] = result;
+                        break;
+                    }
+                    throw std::runtime_error("Error, attempted to call a nil value.");
+                }
+                if (arg_count != closure->m_function->m_arity) {
+                    throw std::runtime_error("Error, wrong number of arguments.");
+                }
+                MemoTable *memo = closure->m_memo;
+                if (memo && memo->caches({sp - arg_count, arg_count})) {
+                    if (const Value *cached = memo->find({sp - arg_count, arg_count})) {
+                        sp -= arg_count;
+                        sp[-1] = *cached;
+                        break;
+                    }
+                    m_memo_keys.insert(m_memo_keys.end(), sp - arg_count, sp);
+                } else {
+                    memo = nullptr;
+                }
+                if (m_frames.size() >= FRAMES_MAX) {
+                    throw std::runtime_error("Stack overflow.");
+                }
+
+                frame->ip = ip;
+                const size_t base = sp - m_stack.data() - arg_count - 1;
+                m_stack_top = sp - m_stack.data();
+                reserveStack(base + closure->m_function->m_max_stack);
+
+                if (m_profiler) {
+                    const VmFunction &function = *closure->m_function;
+                    const size_t call_offset = ip - chunk->m_code.data() - 2;
+                    m_profiler->enter(m_profiler->function(function.m_declaration, function.m_name, function.m_line),
+                                      chunk->m_lines[call_offset]);
+                }
+                m_frames.push_back({closure, closure->m_function->m_chunk.m_code.data(), base, memo});
+                frame = &m_frames.back();
+                chunk = &closure->m_function->m_chunk;
+                ip = frame->ip;
+                slots = m_stack.data() + base;
+                sp = m_stack.data() + m_stack_top;
+                break;
+            }
+            case OpCode::CLOSURE:
+            case OpCode::CLOSURE_LONG: {
+                const auto &function = chunk->m_functions[readIndex(op, OpCode::CLOSURE_LONG)];
+                m_stack_top = sp - m_stack.data();
+                auto *closure = heap().make<VmClosure>(function);
+                if (m_memoizer && function->m_pure) {
+                    closure->m_memo = &m_memoizer->table(function->m_declaration, function->m_name, function->m_line,
+                                                         function->m_arity, function->m_memo_deps);
+                }
+                for (size_t i = 0; i < function->m_upvalue_count; ++i) {
+                    const bool is_local = readByte() != 0;
+                    const uint16_t index = readShort();
+                    closure->m_upvalues.push_back(is_local ? captureUpvalue(frame->base + index)
+                                                           : frame->closure->m_upvalues[index]);
+                }
+                *sp++ = Value::object(closure);
+                break;
+            }
+            case OpCode::RETURN: {
+                const Value result = *--sp;
+                const size_t base = frame->base;
+                closeUpvalues(base);
+                if (MemoTable *memo = frame->memo) {
+                    const size_t key = m_memo_keys.size() - memo->arity();
+                    memo->insert({m_memo_keys.data() + key, memo->arity()}, result);
+                    m_memo_keys.resize(key);
+                }
+                m_frames.pop_back();
+                if (m_profiler && !m_frames.empty()) { m_profiler->exit(); }
+                if (m_frames.empty()) {
+                    m_stack_top = 0;
+                    return;
+                }
+                frame = &m_frames.back();
+                chunk = &frame->closure->m_function->m_chunk;
+                ip = frame->ip;
+                slots = m_stack.data() + frame->base;
+                sp = m_stack.data() + base;
+                *sp++ = result;
+                break;
+            }
+        }
+    }
+}
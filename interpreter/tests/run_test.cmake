@@ -0,0 +1,31 @@
+# Runs one tests/*.lox script and compares what it prints with the .expected file beside it.
+# A first line of the form `// args: ...` adds interpreter flags for that script. A *.repl
+# script is typed into the prompt line by line instead, each line prepared on its own; the
+# prompts are left out of what is compared.
+file(STRINGS ${SCRIPT} first_line LIMIT_COUNT 1)
+set(args "")
+if (first_line MATCHES "^// args: (.*)$")
+    separate_arguments(args UNIX_COMMAND "${CMAKE_MATCH_1}")
+endif ()
+
+if (SCRIPT MATCHES "\\.repl$")
+    execute_process(COMMAND ${INTERPRETER} --engine=${ENGINE} ${args}
+            INPUT_FILE ${SCRIPT}
+            OUTPUT_VARIABLE actual
+            ERROR_QUIET
+            TIMEOUT 60
+            RESULT_VARIABLE result)
+    string(REGEX REPLACE "(> )+" "" actual "${actual}")
+else ()
+    execute_process(COMMAND ${INTERPRETER} --engine=${ENGINE} ${args} ${SCRIPT}
+            OUTPUT_VARIABLE actual
+            ERROR_QUIET
+            TIMEOUT 60
+            RESULT_VARIABLE result)
+endif ()
+string(REGEX REPLACE "\\.(lox|repl)$" ".expected" expected_file ${SCRIPT})
+file(READ ${expected_file} expected)
+
+if (NOT result EQUAL 0 OR NOT actual STREQUAL expected)
+    message(FATAL_ERROR "${SCRIPT} (--engine=${ENGINE}) exited with ${result}, printing:\n${actual}\nexpected:\n${expected}")
+endif ()